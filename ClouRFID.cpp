@@ -11,37 +11,153 @@
  ***********************************************************************/
  
 #include "ClouRFID.h"
-#include < Wasp485.h > #include < inttypes.h > #include "WaspClasses.h"
+#if defined(__linux__)
+  #include <inttypes.h>
+  #include <string.h>
+  #include <stdio.h>
+  #include <stdarg.h>
+  #include <stdlib.h>
+  #include <errno.h>
+  #include <fcntl.h>
+  #include <termios.h>
+  #include <unistd.h>
+  #include <time.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+#else
+  #include <Wasp485.h>
+  #include <inttypes.h>
+  #include "WaspClasses.h"
+#endif
 
 /*******************************************************************************
  * Definitions 
  ******************************************************************************/
 /* Frame head (frame byte 0) */
-# define CR_HEAD 0xAA  //!Frame head
+#define CR_HEAD 0xAA  //!Frame head
 
 /* High byte of protocol control word (frame byte 1) */
-# define CR_IT_RS485(1 << (13 - 8)) //! RS485 mark bit
-# define CR_IT_RINI(1 << (12 - 8))  //! Reader initiate message mark bit
+#define CR_IT_RS485 (1 << (13 - 8)) //! RS485 mark bit
+#define CR_IT_RINI (1 << (12 - 8))  //! Reader initiate message mark bit
 /* Message type number (frame byte 1) */
-# define CR_MT_RERR 0 //! Reader error or warning message
-# define CR_MT_RCFG 1 //! Reader configuration and management message
-# define CR_MT_RFID 2 //! RFID Configuration and operation message
-# define CR_MT_RLOG 3 //! Reader log message
-# define CR_MT_RUPD 4 //! Reader app processor software and baseband software upgrade message.
-# define CR_MT_RTST 5 //!Testing command
-# define CR_MT_MASK 0x07 //! Mask for message type number
+#define CR_MT_RERR 0 //! Reader error or warning message
+#define CR_MT_RCFG 1 //! Reader configuration and management message
+#define CR_MT_RFID 2 //! RFID Configuration and operation message
+#define CR_MT_RLOG 3 //! Reader log message
+#define CR_MT_RUPD 4 //! Reader app processor software and baseband software upgrade message.
+#define CR_MT_RTST 5 //!Testing command
+#define CR_MT_MASK 0x07 //! Mask for message type number
 
 /* Low byte of protocol control word (frame byte 2) */
-# define CR_ERR 0x00 //! MID Illegal command response
+#define CR_ERR 0x00 //! MID Illegal command response
 
-# define CR_RFID_QueryReaderRFIDability 0x00 //! MID Query reader RFID ability
-# define CR_RFID_ReadEPCtag 0x10 //! MID Read EPC tag
-# define CR_RFID_StopCommand 0xFF //! MID Stop command
+#define CR_RFID_QueryReaderRFIDability 0x00 //! MID Query reader RFID ability
+#define CR_RFID_ConfigBaseband 0x0B //! MID Configure reader baseband parameters (Q, session, inventory flag)
+#define CR_RFID_QueryBaseband 0x0C //! MID Query reader baseband parameters
+#define CR_RFID_ReadEPCtag 0x10 //! MID Read EPC tag
+#define CR_RFID_WriteTag 0x11 //! MID Write tag data
+#define CR_RFID_LockTag 0x12 //! MID Lock tag
+#define CR_RFID_StopCommand 0xFF //! MID Stop command
+
+/* Tag FIFO index access (single producer / single consumer lock-free ring) */
+#if defined(__AVR__)
+  //8 bit AVR: single core and byte access is atomic, compiler barrier is enough
+  #define CR_FIFO_LOAD(x) ({ uint8_t v_ = *(volatile uint8_t * )&(x); __asm__ __volatile__("" ::: "memory"); v_; })
+  #define CR_FIFO_STORE(x, v) do { __asm__ __volatile__("" ::: "memory"); *(volatile uint8_t * )&(x) = (v); } while (0)
+#else
+  #define CR_FIFO_LOAD(x) __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+  #define CR_FIFO_STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+#endif
+/* Tag counters: written by producer (may be interrupt), read by consumer */
+#if defined(__AVR__)
+  //32 bit read is not atomic on AVR - read with interrupts disabled
+  #define CR_COUNT_LOAD(x) ({ uint8_t s_ = SREG; cli(); uint32_t v_ = *(volatile uint32_t * )&(x); SREG = s_; v_; })
+  #define CR_COUNT_INC(x) do { (x)++; } while (0)
+#else
+  #define CR_COUNT_LOAD(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
+  #define CR_COUNT_INC(x) __atomic_store_n(&(x), (x) + 1, __ATOMIC_RELAXED)
+#endif
+
+/* Linux platform: waspmote API replacement */
+#if defined(__linux__)
+  //! Wait (ms)
+  static void delay(uint32_t Ms) {
+    usleep(Ms * 1000UL);
+  }
+  //! Time from start (ms)
+  static uint32_t millis() {
+    struct timespec Now;
+    clock_gettime(CLOCK_MONOTONIC, & Now);
+    return (uint32_t)(Now.tv_sec * 1000UL + Now.tv_nsec / 1000000L);
+  }
+  #if RFID_DEBUG_ON > 0
+    //! Debug output to stdout
+    static class {
+      public:
+        void ON() {}
+        void OFF() {}
+        void printf(const char * Format, ...) {
+          va_list Args;
+          va_start(Args, Format);
+          vprintf(Format, Args);
+          va_end(Args);
+        }
+    } USB;
+  #endif
+#endif //defined(__linux__)
+
+/* Spill log record: ClouRFID_Tag_t in native layout, padding record - all bytes 0xFF (Ant == 0xFF) */
+#if ClouRFID_SPILL_batch > 0
+  typedef char CR_SpillRecCheck[(sizeof(ClouRFID_Tag_t) <= ClouRFID_SPILL_rec_len) ? 1 : -1];
+  #define CR_SPILL_EMPTY 0xFF //! Padding record byte
+  #define CR_SPILL_READ 1     //! Log file open for replay
+  #define CR_SPILL_WRITE 2    //! Log file open for append
+  #if !defined(__linux__)
+    static SdFile CR_SpillFile; //! Open log file (one log per program)
+  #endif
+#endif
+
+/* Constant tables and manifest in flash on AVR */
+#if defined(__AVR__)
+  #define CR_FLASH PROGMEM
+  #define CR_FLASH_READ(Dst, Src, Len) memcpy_P((Dst), (Src), (Len))
+#else
+  #define CR_FLASH
+  #define CR_FLASH_READ(Dst, Src, Len) memcpy((Dst), (Src), (Len))
+#endif
+
+/* GS1 EPC (TDS): company prefix bits and digits by partition value */
+static const uint8_t CR_EPC_CompanyBits[7] CR_FLASH = {40, 37, 34, 30, 27, 24, 20};
+static const uint8_t CR_EPC_CompanyDigits[7] CR_FLASH = {12, 11, 10, 9, 8, 7, 6};
+/* GS1 EPC: company prefix + item (serial) reference bits and digits, index - header bit 0 (SGTIN-96, SSCC-96) */
+static const uint8_t CR_EPC_FieldBits[2] CR_FLASH = {44, 58};
+static const uint8_t CR_EPC_FieldDigits[2] CR_FLASH = {13, 17};
+/* Powers of 10 for decimal key and range check */
+static const uint64_t CR_EPC_Pow10[18] CR_FLASH = {
+  1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+  1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+  100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL
+};
 
 /***********************************************************************
  * Methods of the Class
  ***********************************************************************/
 
+ClouRFID::ClouRFID() {
+  memset((void * )(this), 0, sizeof(ClouRFID));
+  #if defined(__linux__)
+    PortFd = -1;
+  #endif
+}
+
+ClouRFID::~ClouRFID() {
+  #if defined(__linux__)
+    SetManifest(0, 0); //unmap manifest file
+    if (PortFd >= 0) close(PortFd);
+    SpillClose();
+  #endif
+}
+
 //!*************************************************************
 //! Name: Start()                          
 //! Description: tart work with RS232/RS485 and USB (for debug)
@@ -50,58 +166,90 @@
 //!       : uint8_t RS485addres : addres on RS485 bus                            
 //! Returns: ClouRFID_OK / ClouRFID_ERROR (ClouRFID_RETURN_t)             
 //!*************************************************************
-ClouRFID_RETURN_t ClouRFID::Start(uint32_t Baudrate, ClouRFID_Interface_t Intrface, uint8_t RS485addres) {#
-  if RFID_DEBUG_ON > 0
+ClouRFID_RETURN_t ClouRFID::Start(uint32_t Baudrate, ClouRFID_Interface_t Intrface, uint8_t RS485addres) {
+  #if RFID_DEBUG_ON > 0
   USB.ON();
-  USB.printf("\n\n\f");#
-  endif
+  USB.printf("\n\n\f");
+  #endif
   //Open port
   uint8_t Retry = 5;
   RS485on = (Intrface == RS485) ? 1 : 0;
   RS485addr = RS485addres;
   while (PortIni(Baudrate) != 0) {
     Retry--;
-    if (Retry == 0) {#
-      if RFID_DEBUG_ON > 0
-      USB.printf("\nRFID ERROR RS485 port not opened");#
-      endif
+    if (Retry == 0) {
+      #if RFID_DEBUG_ON > 0
+      USB.printf("\nRFID ERROR RS485 port not opened");
+      #endif
       PortDeIni();
       return ClouRFID_ERROR;
     }
-  }#
-  if RFID_DEBUG_ON > 0
-  USB.printf("\nRFID RS485 port opened");#
-  endif
+  }
+  #if RFID_DEBUG_ON > 0
+  USB.printf("\nRFID RS485 port opened");
+  #endif
   //Send stop
   StopRFID();
   cParams.AntenaQty = 0;
+  cInvApplied.On = 0; //Reader params unknown
   //Send query reader RFID ability
   cMess.Control = CR_MT_RFID;
   cMess.MessageID = CR_RFID_QueryReaderRFIDability;
   cMess.Len = 0;
   SendPacket( & cMess);
   //Wait for response
-  if ((GetResp( & cMess) == 0) && (cMess.MessageID == CR_RFID_QueryReaderRFIDability)) {#
-    if RFID_DEBUG_ON > 0
-    USB.printf("\nRFID Connect OK, power: %d-%d dBm, antQty: %d ", cMess.Data[0], cMess.Data[1], cMess.Data[2]);#
-    endif
+  if ((GetResp( & cMess) == 0) && (cMess.MessageID == CR_RFID_QueryReaderRFIDability)) {
+    #if RFID_DEBUG_ON > 0
+    USB.printf("\nRFID Connect OK, power: %d-%d dBm, antQty: %d ", cMess.Data[0], cMess.Data[1], cMess.Data[2]);
+    #endif
     cParams.TxPowerMin = cMess.Data[0];
     cParams.TxPowerMax = cMess.Data[1];
     cParams.AntenaQty = cMess.Data[2];
     if ((cParams.AntenaQty <= 4) && (cMess.Data[0] < cMess.Data[1]) && (cMess.Data[1] <= 36)) {
+      if (cInvDefault.On == 0) { //Reader default inventory params (first start only - later reader may have ours)
+        cMess.Control = CR_MT_RFID;
+        cMess.MessageID = CR_RFID_QueryBaseband;
+        cMess.Len = 0;
+        SendPacket( & cMess);
+        //Response: data speed, Q, session, inventory flag
+        if ((GetResp( & cMess) == 0) && (cMess.MessageID == CR_RFID_QueryBaseband) && (cMess.Len >= 4)) {
+          cInvDefault.On = 1;
+          cInvDefault.Q = cMess.Data[1];
+          cInvDefault.Session = cMess.Data[2];
+          cInvDefault.Target = cMess.Data[3];
+          #if RFID_DEBUG_ON > 0
+            USB.printf("\nRFID Default inventory S%d T%d Q%d", cInvDefault.Session, cInvDefault.Target, cInvDefault.Q);
+          #endif
+        }
+      }
       return ClouRFID_OK;
     }
 
   }
   //No response
-  #
-  if RFID_DEBUG_ON > 0
-  USB.printf("\nRFID ERROR connection");#
-  endif
+  #if RFID_DEBUG_ON > 0
+  USB.printf("\nRFID ERROR connection");
+  #endif
   PortDeIni();
   return ClouRFID_ERROR;
 }
 
+#if defined(__linux__)
+//!*************************************************************
+//! Name: Start()                          
+//! Description: Start work with serial device (Linux)
+//! Param : const char * Device : tty device name
+//!       : uint32_t Baudrate : speed of port (bits / sec)
+//!       : ClouRFID_Interface_t Intrface : RS485 /  RS232
+//!       : uint8_t RS485addres : addres on RS485 bus                            
+//! Returns: ClouRFID_OK / ClouRFID_ERROR (ClouRFID_RETURN_t)             
+//!*************************************************************
+ClouRFID_RETURN_t ClouRFID::Start(const char * Device, uint32_t Baudrate, ClouRFID_Interface_t Intrface, uint8_t RS485addres) {
+  PortName = Device;
+  return Start(Baudrate, Intrface, RS485addres);
+}
+#endif //defined(__linux__)
+
 //!*************************************************************
 //! Name: ScanTags()                          
 //! Description: Scan tags and add to FIFO
@@ -109,70 +257,74 @@ ClouRFID_RETURN_t ClouRFID::Start(uint32_t Baudrate, ClouRFID_Interface_t Intrfa
 //! Returns: void             
 //!*************************************************************
 void ClouRFID::ScanTags(uint8_t Ant) {
-  # if (ClouRFID_TID_max_len != 0) || (ClouRFID_EPC_max_len != 0) /* +++ User data len test here */
+  #if (ClouRFID_TID_max_len != 0) || (ClouRFID_EPC_max_len != 0) /* +++ User data len test here */
   if (cParams.AntenaQty == 0) return;
+  #if ClouRFID_FIFO_high > 0
+    if (tagPaused) { //inventory paused by FIFO high-water mark
+      if (GetTagQty() > ClouRFID_FIFO_low) {
+        tagCycleSkip = 1; //tags not read - no presence aging
+        return;
+      }
+      tagPaused = 0;
+      tagPauseTime += millis() - tagPauseStart;
+      #if RFID_DEBUG_ON > 0
+        USB.printf("\nRFID Inventory resume");
+      #endif
+    }
+  #endif //ClouRFID_FIFO_high>0
   StopRFID();
   if (Ant >= cParams.AntenaQty) {
     Ant = cParams.AntenaQty;
   }
   Ant--;
-  # if ClouRFID_TID_max_len == 0 //EPC only mode
-  cMess.Control = CR_MT_RFID;
-  cMess.MessageID = CR_RFID_ReadEPCtag;
-  cMess.Len = 2;
-  cMess.Data[0] = (1 << Ant); //Antenna port No.
-  cMess.Data[1] = 0; //0 - Single read mode: reader make one round tag reading on each enabled antenna, and then enter idle mode.
-    # if RFID_DEBUG_ON > 0
-    USB.printf("\nRFID Start scan EPC only  ");
-    # endif
-  # else //EPC+TID or TID mode
-    cMess.Control = CR_MT_RFID;
-  cMess.MessageID = CR_RFID_ReadEPCtag;
-  cMess.Len = 5;
-  cMess.Data[0] = (1 << Ant); //Antenna port No.
-  cMess.Data[1] = 0; //0 - Single read mode: reader make one round tag reading on each enabled antenna, and then enter idle mode
-  //PID 2: TID read parameter
-  cMess.Data[2] = 2; //PID Number
-  cMess.Data[3] = 0; //Byte 0: TID read mode configuration，0，TID read length self-adapter, but max. length not exceed byte 1 defined length.
-  cMess.Data[4] = (ClouRFID_TID_max_len / 2); //Byte 1：TID data word length to be read (word，16bits，below same). (6+1)*2=14 bytes
-    # if RFID_DEBUG_ON > 0
-      USB.printf("\nRFID Start scan EPC & TID");
-    # endif
-  # endif //ClouRFID_TID_max_len==0 
-
-  /* +++ User data read command here */
-
-  if (RS485on > 0) { //RS485 is on
-    cMess.Data[1] = 0; //MUST BE ZERO - continius read blocked intrface!
-  }
-
+  //Inventory params of antenna
+  InventoryIni(Ant);
+  RoundQty = 0;
+  ReadCommand(Ant, 0); //0 - Single read mode: reader make one round tag reading on each enabled antenna, and then enter idle mode
   SendPacket( & cMess);
 
   //Wait for response
   if ((GetResp( & cMess) == 0) && (cMess.MessageID == CR_RFID_ReadEPCtag)) {
-    # if RFID_DEBUG_ON > 0
+    #if RFID_DEBUG_ON > 0
     USB.printf("\nRFID Tag read Start! ");
-    # endif
+    #endif
+    tagRound = 1; //tags of round are staged, strongest read of tag is kept
     //Wait for tag read (MessageID == 0)
     while (GetResp( & cMess) == 0) { //EPC tag data upload 
       if (cMess.MessageID == 0) {
-        # if RFID_DEBUG_ON > 0
+        #if RFID_DEBUG_ON > 0
         USB.printf("\nRFID Tag read, Ant: %d ", Ant);
-        # endif
+        #endif
         AddTag( & cMess);
+        #if ClouRFID_FIFO_high > 0
+          if (FifoQty(tagFIFO_stage) >= ClouRFID_FIFO_high) { //consumer falls behind - pause inventory
+            PublishTags();
+            StopRFID();
+            tagPaused = 1;
+            tagCycleSkip = 1;
+            tagPauseStart = millis();
+            #if RFID_DEBUG_ON > 0
+              USB.printf("\nRFID Inventory pause");
+            #endif
+            return;
+          }
+        #endif //ClouRFID_FIFO_high>0
       } else if (cMess.MessageID == 1) { //EPC tag reading finish 
-        # if RFID_DEBUG_ON > 0
+        #if RFID_DEBUG_ON > 0
           USB.printf("\nRFID Tag read End");
-        # endif
+        #endif
+        RoundTags[Ant] = RoundQty;
+        PublishTags();
         return;
       }
     }
   }
-  # if RFID_DEBUG_ON > 0
+  PublishTags(); //no read finish
+  #if RFID_DEBUG_ON > 0
   USB.printf("\nRFID Scan End");
-  # endif
+  #endif
 
-  # endif(ClouRFID_TID_max_len != 0) && (ClouRFID_EPC_max_len != 0)
+  #endif //(ClouRFID_TID_max_len != 0) || (ClouRFID_EPC_max_len != 0)
 }
 
 //!*************************************************************
@@ -183,32 +335,81 @@ void ClouRFID::ScanTags(uint8_t Ant) {
 //!*************************************************************
 void ClouRFID::Stop() {
   StopRFID();
-  PortDeIni();#
-  if RFID_DEBUG_ON > 0
-  USB.printf("\nRFID Stoped");#
-  endif
+  PortDeIni();
+  SpillClose(); //replay file
+  #if RFID_DEBUG_ON > 0
+  USB.printf("\nRFID Stoped");
+  #endif
+}
+
+//!*************************************************************
+//! Name: EndCycle()                          
+//! Description: End of scan cycle, add DEPARTED and PRESENT events to FIFO (not if inventory paused),
+//!              clear "already reported" filter at end of epoch, write full spill buffers
+//! Param: void                         
+//! Returns: void             
+//!*************************************************************
+void ClouRFID::EndCycle() {
+  #if ClouRFID_PRESENCE_len > 0
+    #if ClouRFID_FIFO_high > 0
+      uint8_t Skip = tagCycleSkip; //inventory paused - tags not read in this cycle
+      tagCycleSkip = 0;
+    #else
+      uint8_t Skip = 0;
+    #endif
+    for (uint8_t i = 0; (i < ClouRFID_PRESENCE_len) && (Skip == 0); i++) {
+      if (tagPresence[i].Miss == 0) continue; //free cell
+      if (tagPresence[i].Miss > ClouRFID_PRESENCE_miss) { //tag lost
+        tagPresence[i].Tag.Event = ClouRFID_DEPARTED;
+        if (QueueTag( & tagPresence[i].Tag) == 0) {
+          tagPresence[i].Miss = 0; //free cell
+        }
+        continue; //FIFO full - try on next cycle
+      }
+      if (tagPresence[i].Miss == 1) { //tag read in this cycle
+        tagPresence[i].Age++;
+        #if ClouRFID_PRESENCE_heartbeat > 0
+          if (tagPresence[i].Age >= ClouRFID_PRESENCE_heartbeat) {
+            tagPresence[i].Tag.Event = ClouRFID_PRESENT;
+            if (QueueTag( & tagPresence[i].Tag) == 0) {
+              tagPresence[i].Age = 0;
+            }
+          }
+        #endif //ClouRFID_PRESENCE_heartbeat>0
+      }
+      tagPresence[i].Miss++;
+    }
+  #endif //ClouRFID_PRESENCE_len>0
+
+  #if (ClouRFID_FILTER_bits > 0) && (ClouRFID_FILTER_epoch > 0)
+    tagFilter_cycle++;
+    if (tagFilter_cycle >= ClouRFID_FILTER_epoch) { //new epoch
+      ClearFilter();
+    }
+  #endif
+
+  #if ClouRFID_SPILL_batch > 0
+    if (spillOn) SpillSync(0); //write full buffers of scan
+  #endif //ClouRFID_SPILL_batch>0
 }
 
 //!*************************************************************
 //! Name: Stop()                          
-//! Description: Get tag from FIFO
+//! Description: Get tag from FIFO (consumer side)
 //! Param : ClouRFID_Tag_t * Out : pointer to reading ClouRFID_Tag_t                         
 //! Returns: ClouRFID_OK / ClouRFID_ERROR ( ClouRFID_RETURN_t )             
 //!*************************************************************
 ClouRFID_RETURN_t ClouRFID::GetTag(ClouRFID_Tag_t * Out) {
-    if (tagFIFO_count) {
-      //Get TAG from FIFO
-      memcpy((uint8_t * )(Out), (uint8_t * )( & tagFIFO[tagFIFO_out]), sizeof(ClouRFID_Tag_t));
-      //Update in index
-      tagFIFO_out++;
-      if (tagFIFO_out >= ClouRFID_TAG_FIFO_len + 1) {
-        tagFIFO_out = 0;
-      }
-      //Update data count
-      tagFIFO_count--;
-      return ClouRFID_OK;
-    }
+  uint8_t Out_i = tagFIFO_out;
+  if (Out_i == CR_FIFO_LOAD(tagFIFO_in)) { //FIFO empty
     return ClouRFID_ERROR;
+  }
+  //Get TAG from FIFO
+  memcpy((uint8_t * )(Out), (uint8_t * )( & tagFIFO[Out_i]), sizeof(ClouRFID_Tag_t));
+  //Update out index (release cell to producer)
+  Out_i = (Out_i >= ClouRFID_TAG_FIFO_len) ? 0 : (Out_i + 1);
+  CR_FIFO_STORE(tagFIFO_out, Out_i);
+  return ClouRFID_OK;
 }
 
 //!*************************************************************
@@ -218,7 +419,412 @@ ClouRFID_RETURN_t ClouRFID::GetTag(ClouRFID_Tag_t * Out) {
 //! Returns: quantity of tags in FIFO             
 //!*************************************************************
 uint16_t ClouRFID::GetTagQty() {
-  return tagFIFO_count;
+  return FifoQty(CR_FIFO_LOAD(tagFIFO_in));
+}
+
+//!*************************************************************
+//! Name: SetHandler()                          
+//! Description: Set handler of reader initiated messages
+//! Param : ClouRFID_MesType_t Type : message type
+//!       : ClouRFID_Handler_t Handler : handler function (0 - drop messages)
+//! Returns: void             
+//!*************************************************************
+void ClouRFID::SetHandler(ClouRFID_MesType_t Type, ClouRFID_Handler_t Handler) {
+  Handlers[Type & CR_MT_MASK] = Handler;
+}
+
+//!*************************************************************
+//! Name: GetLostQty()                          
+//! Description: Get quantity of tags lost (FIFO and spill buffer full)
+//! Param: void                         
+//! Returns: quantity of lost tags
+//!*************************************************************
+uint32_t ClouRFID::GetLostQty() {
+  return CR_COUNT_LOAD(tagLost);
+}
+
+//!*************************************************************
+//! Name: GetPauseTime()                          
+//! Description: Get total time of inventory pauses by FIFO high-water mark
+//! Param: void                         
+//! Returns: pause time (ms)
+//!*************************************************************
+uint32_t ClouRFID::GetPauseTime() {
+  #if ClouRFID_FIFO_high > 0
+    if (tagPaused) return tagPauseTime + (millis() - tagPauseStart);
+    return tagPauseTime;
+  #else
+    return 0;
+  #endif
+}
+
+//!*************************************************************
+//! Name: TagOp()                          
+//! Description: Write tag memory or lock tag
+//! Param : ClouRFID_TagOp_t * Op : pointer to operation (Result is updated)
+//! Returns: ClouRFID_OK / ClouRFID_ERROR (ClouRFID_RETURN_t)             
+//!*************************************************************
+ClouRFID_RETURN_t ClouRFID::TagOp(ClouRFID_TagOp_t * Op) {
+  return (TagOpBatch(Op, 1) == 1) ? ClouRFID_OK : ClouRFID_ERROR;
+}
+
+//!*************************************************************
+//! Name: TagOpBatch()                          
+//! Description: Write tag memory or lock tags by list, command for next tag is sent
+//!              while result of previous one is outstanding (RS232 on Linux),
+//!              after timeout outstanding commands get ClouRFID_OP_NO_RESP
+//! Param : ClouRFID_TagOp_t * Ops : pointer to operations list (Result is updated)
+//!       : uint16_t Qty : qty of operations
+//! Returns: qty of successful operations
+//!*************************************************************
+uint16_t ClouRFID::TagOpBatch(ClouRFID_TagOp_t * Ops, uint16_t Qty) {
+  ClouRFID_Mes_t Tx;
+  uint16_t Sent = 0; //next operation for send
+  uint16_t Done = 0; //next operation waiting for result
+  uint16_t Ok = 0;
+  uint8_t Out = 0; //commands waiting for result
+  uint8_t Depth = (RS485on > 0) ? 1 : ClouRFID_OP_depth; //RS485 is half duplex
+  uint32_t Start = millis();
+
+  for (uint16_t i = 0; i < Qty; i++) {
+    Ops[i].Result = (OpBuild( & Ops[i], & Tx) == 0) ? ClouRFID_OP_NO_RESP : ClouRFID_OP_PARAM;
+  }
+  if (cParams.AntenaQty == 0) return 0;
+  StopRFID();
+  while (Done < Qty) {
+    //Skip wrong operations
+    while ((Done < Qty) && (Ops[Done].Result == ClouRFID_OP_PARAM)) Done++;
+    if (Sent < Done) Sent = Done;
+    //Queue commands, pipeline only commands with same MID (response is matched by MID)
+    while ((Sent < Qty) && (Out < Depth)) {
+      if (Ops[Sent].Result == ClouRFID_OP_PARAM) {
+        Sent++;
+        continue;
+      }
+      OpBuild( & Ops[Sent], & Tx);
+      if ((Out > 0) && (Tx.MessageID != PendingMID)) break;
+      SendPacket( & Tx);
+      Sent++;
+      Out++;
+    }
+    if (Done >= Qty) break;
+    //Wait for result of oldest command
+    if ((GetResp( & cMess, ClouRFID_OP_timeout / 10) == 0) && (cMess.Len > 0)) {
+      Ops[Done].Result = cMess.Data[0];
+      if (cMess.Data[0] == 0) Ok++;
+      Out--;
+    } else {
+      //No response - results of commands sent later are unknown too. Late responses are
+      //discarded (not matched to next commands by MID) till all outstanding or reader quiet
+      while ((Out > 0) && (GetResp( & cMess, ClouRFID_OP_timeout / 10) == 0)) Out--;
+      PortFlush();
+      Done = Sent;
+      Out = 0;
+      continue;
+    }
+    #if RFID_DEBUG_ON > 0
+      USB.printf("\nRFID Tag operation %d result %d", Done, Ops[Done].Result);
+    #endif
+    Done++;
+  }
+  uint32_t Time = millis() - Start;
+  OpRate = (Time > 0) ? (uint32_t)((uint64_t)(Ok) * 60000UL / Time) : 0;
+  return Ok;
+}
+
+//!*************************************************************
+//! Name: GetOpRate()                          
+//! Description: Get successful tag operations per minute of last batch
+//! Param: void                         
+//! Returns: tags / minute
+//!*************************************************************
+uint32_t ClouRFID::GetOpRate() {
+  return OpRate;
+}
+
+//!*************************************************************
+//! Name: DecodeEPC()                          
+//! Description: Decode SGTIN-96 / SSCC-96 EPC of tag (shifts and tables only)
+//! Param : const ClouRFID_Tag_t * Tag : pointer to tag
+//!       : ClouRFID_EPC_t * Out : pointer to decoded EPC
+//! Returns: ClouRFID_OK / ClouRFID_ERROR (ClouRFID_RETURN_t)             
+//!*************************************************************
+ClouRFID_RETURN_t ClouRFID::DecodeEPC(const ClouRFID_Tag_t * Tag, ClouRFID_EPC_t * Out) {
+  #if ClouRFID_EPC_max_len >= 12
+    uint8_t Header = Tag -> EPC[0];
+    if ((Tag -> EPC_Len < 12) || ((Header != ClouRFID_EPC_SGTIN96) && (Header != ClouRFID_EPC_SSCC96))) return ClouRFID_ERROR;
+    //EPC bits 8..63 and 64..95
+    uint64_t High = 0;
+    for (uint8_t i = 1; i < 8; i++) High = (High << 8) | Tag -> EPC[i];
+    uint32_t Low = ((uint32_t) Tag -> EPC[8] << 24) | ((uint32_t) Tag -> EPC[9] << 16) | ((uint16_t) Tag -> EPC[10] << 8) | Tag -> EPC[11];
+    uint8_t Partition = (uint8_t)(High >> 50) & 0x07;
+    if (Partition > 6) return ClouRFID_ERROR;
+
+    uint8_t Scheme = Header & 0x01;
+    uint8_t FieldBits, FieldDigits, CompanyBits, CompanyDigits;
+    CR_FLASH_READ( & FieldBits, & CR_EPC_FieldBits[Scheme], 1);
+    CR_FLASH_READ( & FieldDigits, & CR_EPC_FieldDigits[Scheme], 1);
+    CR_FLASH_READ( & CompanyBits, & CR_EPC_CompanyBits[Partition], 1);
+    CR_FLASH_READ( & CompanyDigits, & CR_EPC_CompanyDigits[Partition], 1);
+    uint8_t ItemBits = FieldBits - CompanyBits;
+    uint8_t ItemDigits = FieldDigits - CompanyDigits;
+
+    //Company prefix + item reference field starts from EPC bit 14
+    uint64_t Field;
+    if (Scheme == 0) {
+      Field = (High >> 6) & ((1ULL << 44) - 1);
+      Out -> Serial = ((High & 0x3F) << 32) | Low;
+    } else {
+      Field = ((High & ((1ULL << 50) - 1)) << 8) | (Low >> 24);
+      Out -> Serial = 0;
+    }
+    Out -> Company = Field >> ItemBits;
+    Out -> Item = Field & ((1ULL << ItemBits) - 1);
+
+    //Range check of decimal fields
+    uint64_t CompanyMax, ItemMax;
+    CR_FLASH_READ( & CompanyMax, & CR_EPC_Pow10[CompanyDigits], sizeof(uint64_t));
+    CR_FLASH_READ( & ItemMax, & CR_EPC_Pow10[ItemDigits], sizeof(uint64_t));
+    if ((Out -> Company >= CompanyMax) || (Out -> Item >= ItemMax)) return ClouRFID_ERROR;
+
+    Out -> Header = Header;
+    Out -> Filter = (uint8_t)(High >> 53);
+    Out -> Partition = Partition;
+    Out -> CompanyDigits = CompanyDigits;
+    Out -> Key = ((uint64_t) Header << 57) | (Out -> Company * ItemMax + Out -> Item);
+    return ClouRFID_OK;
+  #else
+    return ClouRFID_ERROR;
+  #endif
+}
+
+//!*************************************************************
+//! Name: SetManifest()                          
+//! Description: Set manifest table for SKU lookup
+//! Param : const ClouRFID_Sku_t * Table : records sorted by Key (flash on AVR), 0 - no manifest
+//!       : uint32_t Qty : qty of records
+//! Returns: void
+//!*************************************************************
+void ClouRFID::SetManifest(const ClouRFID_Sku_t * Table, uint32_t Qty) {
+  #if defined(__linux__)
+    if (ManifestMap != 0) {
+      munmap(ManifestMap, ManifestSize);
+      ManifestMap = 0;
+      ManifestSize = 0;
+    }
+  #endif
+  Manifest = Table;
+  ManifestQty = (Table != 0) ? Qty : 0;
+}
+
+#if defined(__linux__)
+//!*************************************************************
+//! Name: OpenManifest()                          
+//! Description: Map manifest file (ClouRFID_Sku_t records sorted by Key) to memory
+//! Param : const char * File : file name
+//! Returns: ClouRFID_OK / ClouRFID_ERROR (ClouRFID_RETURN_t)             
+//!*************************************************************
+ClouRFID_RETURN_t ClouRFID::OpenManifest(const char * File) {
+  struct stat St;
+  SetManifest(0, 0);
+  int Fd = open(File, O_RDONLY);
+  if (Fd < 0) return ClouRFID_ERROR;
+  if ((fstat(Fd, & St) != 0) || (St.st_size < (off_t) sizeof(ClouRFID_Sku_t)) || (St.st_size > (off_t) 0xFFFFFFF0UL) || ((St.st_size % sizeof(ClouRFID_Sku_t)) != 0)) {
+    close(Fd);
+    return ClouRFID_ERROR;
+  }
+  void * Map = mmap(0, St.st_size, PROT_READ, MAP_SHARED, Fd, 0);
+  close(Fd);
+  if (Map == MAP_FAILED) return ClouRFID_ERROR;
+  ManifestMap = Map;
+  ManifestSize = (uint32_t) St.st_size;
+  Manifest = (const ClouRFID_Sku_t * ) Map;
+  ManifestQty = (uint32_t)(ManifestSize / sizeof(ClouRFID_Sku_t));
+  #if RFID_DEBUG_ON > 0
+    USB.printf("\nRFID Manifest %s: %lu records", File, (unsigned long) ManifestQty);
+  #endif
+  return ClouRFID_OK;
+}
+#endif //defined(__linux__)
+
+//!*************************************************************
+//! Name: FindSku()                          
+//! Description: Binary search of key in manifest
+//! Param : uint64_t Key : manifest key (ClouRFID_EPC_t)
+//!       : uint32_t * Sku : pointer to found SKU
+//! Returns: ClouRFID_OK / ClouRFID_ERROR (not found) (ClouRFID_RETURN_t)             
+//!*************************************************************
+ClouRFID_RETURN_t ClouRFID::FindSku(uint64_t Key, uint32_t * Sku) {
+  ClouRFID_Sku_t Rec;
+  uint32_t Lo = 0;
+  uint32_t Hi = ManifestQty;
+  while (Lo < Hi) {
+    uint32_t Mid = Lo + ((Hi - Lo) >> 1);
+    CR_FLASH_READ( & Rec, & Manifest[Mid], sizeof(ClouRFID_Sku_t));
+    if (Rec.Key < Key) {
+      Lo = Mid + 1;
+    } else if (Rec.Key > Key) {
+      Hi = Mid;
+    } else { * Sku = Rec.Sku;
+      return ClouRFID_OK;
+    }
+  }
+  return ClouRFID_ERROR;
+}
+
+//!*************************************************************
+//! Name: GetSku()                          
+//! Description: Decode EPC of tag and find it in manifest
+//! Param : const ClouRFID_Tag_t * Tag : pointer to tag
+//!       : uint32_t * Sku : pointer to found SKU
+//! Returns: ClouRFID_OK / ClouRFID_ERROR (not GS1 EPC or not found) (ClouRFID_RETURN_t)             
+//!*************************************************************
+ClouRFID_RETURN_t ClouRFID::GetSku(const ClouRFID_Tag_t * Tag, uint32_t * Sku) {
+  ClouRFID_EPC_t Epc;
+  if (DecodeEPC(Tag, & Epc) != ClouRFID_OK) return ClouRFID_ERROR;
+  return FindSku(Epc.Key, Sku);
+}
+
+//!*************************************************************
+//! Name: SetInventory()                          
+//! Description: Set inventory params (Gen2 session, target, Q) of antenna
+//! Param : uint8_t Ant : antenna ID (1..4), 0 - all antennas
+//!       : uint8_t Session : session 0..3 (S0-S3), ClouRFID_SESSION_DEFAULT - reader default params
+//!       : ClouRFID_Target_t Target : inventoried flag target A / B / A and B (toggle)
+//!       : uint8_t Q : initial Q 0..15 (reader adjusts Q dynamically), ClouRFID_Q_AUTO - by last round tags qty
+//! Returns: ClouRFID_OK / ClouRFID_ERROR (ClouRFID_RETURN_t)             
+//!*************************************************************
+ClouRFID_RETURN_t ClouRFID::SetInventory(uint8_t Ant, uint8_t Session, ClouRFID_Target_t Target, uint8_t Q) {
+  if ((Ant > 4) || ((Session > 3) && (Session != ClouRFID_SESSION_DEFAULT)) ||
+    (Target > ClouRFID_TARGET_AB) || ((Q > 15) && (Q != ClouRFID_Q_AUTO))) {
+    return ClouRFID_ERROR;
+  }
+  for (uint8_t i = 0; i < 4; i++) {
+    if ((Ant == 0) || (Ant == i + 1)) {
+      cInventory[i].On = (Session == ClouRFID_SESSION_DEFAULT) ? 0 : 1;
+      cInventory[i].Session = Session;
+      cInventory[i].Target = Target;
+      cInventory[i].Q = Q;
+    }
+  }
+  return ClouRFID_OK;
+}
+
+//!*************************************************************
+//! Name: ClearFilter()                          
+//! Description: Clear "already reported" filter (start new epoch)
+//! Param: void                         
+//! Returns: void             
+//!*************************************************************
+void ClouRFID::ClearFilter() {
+  #if ClouRFID_FILTER_bits > 0
+    memset(tagFilter, 0, sizeof(tagFilter));
+    tagFilter_set = 0;
+    tagFilter_cycle = 0;
+  #endif //ClouRFID_FILTER_bits>0
+}
+
+//!*************************************************************
+//! Name: GetFilterFPR()                          
+//! Description: Get false positive rate estimate of "already reported" filter
+//!              FPR = (set bits / filter bits) ^ k
+//! Param: void                         
+//! Returns: probability (0..1) of new tag suppression
+//!*************************************************************
+float ClouRFID::GetFilterFPR() {
+  float Ret = 0;
+  #if ClouRFID_FILTER_bits > 0
+    float Fill = (float)(tagFilter_set) / ClouRFID_FILTER_bits;
+    Ret = 1;
+    for (uint8_t i = 0; i < ClouRFID_FILTER_k; i++) {
+      Ret *= Fill;
+    }
+  #endif //ClouRFID_FILTER_bits>0
+  return Ret;
+}
+
+//!*************************************************************
+//! Name: SpillTags()                          
+//! Description: Move all tags from FIFO to spill log (before buffered ones), write whole blocks
+//! Param: void                         
+//! Returns: ClouRFID_OK / ClouRFID_ERROR ( ClouRFID_RETURN_t )             
+//!*************************************************************
+ClouRFID_RETURN_t ClouRFID::SpillTags() {
+  #if ClouRFID_SPILL_batch > 0
+    if (SpillSync(1) == 0) return ClouRFID_OK;
+  #endif //ClouRFID_SPILL_batch>0
+  return ClouRFID_ERROR;
+}
+
+//!*************************************************************
+//! Name: SpillFlush()                          
+//! Description: Move all tags from FIFO and RAM buffers to spill log, block is padded by empty records
+//! Param: void                         
+//! Returns: ClouRFID_OK / ClouRFID_ERROR ( ClouRFID_RETURN_t )             
+//!*************************************************************
+ClouRFID_RETURN_t ClouRFID::SpillFlush() {
+  #if ClouRFID_SPILL_batch > 0
+    if (SpillSync(1) != 0) return ClouRFID_ERROR;
+    //Whole blocks are written, rest of records in buffer being filled
+    uint8_t * Buf = spillBuf[spillAct];
+    if (spillCount[spillAct] == 0) return ClouRFID_OK;
+    memset( & Buf[spillCount[spillAct] * ClouRFID_SPILL_rec_len], CR_SPILL_EMPTY, sizeof(spillBuf[0]) - spillCount[spillAct] * ClouRFID_SPILL_rec_len);
+    if (SpillOpen(CR_SPILL_WRITE) != 0) return ClouRFID_ERROR;
+    uint8_t Ret = SpillWrite(Buf, sizeof(spillBuf[0]));
+    if ((SpillClose() != 0) || (Ret != 0)) return ClouRFID_ERROR;
+    spillCount[spillAct] = 0;
+    return ClouRFID_OK;
+  #else
+    return ClouRFID_ERROR;
+  #endif //ClouRFID_SPILL_batch>0
+}
+
+//!*************************************************************
+//! Name: ReplayTag()                          
+//! Description: Get next tag from spill log file (in write order),
+//!              tags of RAM buffers are written at end of log
+//! Param : ClouRFID_Tag_t * Out : pointer to reading ClouRFID_Tag_t                         
+//! Returns: ClouRFID_OK / ClouRFID_ERROR - end of log ( ClouRFID_RETURN_t )             
+//!*************************************************************
+ClouRFID_RETURN_t ClouRFID::ReplayTag(ClouRFID_Tag_t * Out) {
+  #if ClouRFID_SPILL_batch > 0
+    uint8_t Rec[ClouRFID_SPILL_rec_len];
+    while (1) {
+      //Log file is kept open for replay (reopened at replay offset after log write)
+      while ((SpillOpen(CR_SPILL_READ) == 0) && (SpillRead(Rec, ClouRFID_SPILL_rec_len) == 0)) {
+        spillRead += ClouRFID_SPILL_rec_len;
+        memcpy((uint8_t * )(Out), Rec, sizeof(ClouRFID_Tag_t));
+        if (Out->Ant != CR_SPILL_EMPTY) return ClouRFID_OK; //skip padding records
+      }
+      //End of log file
+      SpillClose();
+      if ((spillCount[0] == 0) && (spillCount[1] == 0)) { //log replayed - new tags to FIFO
+        spillOn = 0;
+        break;
+      }
+      if (SpillFlush() != ClouRFID_OK) break;
+    }
+  #endif //ClouRFID_SPILL_batch>0
+  return ClouRFID_ERROR;
+}
+
+//!*************************************************************
+//! Name: SpillClear()                          
+//! Description: Delete spill log file
+//! Param: void                         
+//! Returns: void             
+//!*************************************************************
+void ClouRFID::SpillClear() {
+  #if ClouRFID_SPILL_batch > 0
+    SpillClose();
+    #if defined(__linux__)
+      remove(ClouRFID_SPILL_file);
+    #else
+      SD.del(ClouRFID_SPILL_file);
+    #endif
+    spillRead = 0;
+    spillOn = (spillCount[0] != 0) || (spillCount[1] != 0);
+  #endif //ClouRFID_SPILL_batch>0
 }
 
 //!*************************************************************
@@ -261,10 +867,14 @@ void ClouRFID::CalcCRC16(uint16_t * crcValue, uint8_t newByte) {
 //! Returns: void           
 //!*************************************************************
 void ClouRFID::SendByte(uint8_t Data) {
-  W485.send(Data);#
-  if RFID_DEBUG_ON > 1
-  USB.printf(" %02x", Data);#
-  endif
+  #if defined(__linux__)
+    if (PortTxLen < sizeof(PortTxBuf)) PortTxBuf[PortTxLen++] = Data;
+  #else
+    W485.send(Data);
+  #endif
+  #if RFID_DEBUG_ON > 1
+  USB.printf(" %02x", Data);
+  #endif
 }
 
 //!*************************************************************
@@ -275,28 +885,30 @@ void ClouRFID::SendByte(uint8_t Data) {
 //!*************************************************************
 void ClouRFID::SendPacket(ClouRFID_Mes_t * Mess) {
   //On TX
-  W485.reception(DISABLE);
-  W485.transmission(ENABLE);
-  delay(2);
-  # if RFID_DEBUG_ON > 1
+  PortTX();
+  #if RFID_DEBUG_ON > 1
     USB.printf("\nRFID send:   ");
-  # endif
+  #endif
+
+  //Command waiting for response
+  PendingType = Mess->Control & CR_MT_MASK;
+  PendingMID = Mess->MessageID;
 
   //Frame head
   SendByte((uint8_t)(CR_HEAD));
 
-  CRC = 0;
+  uint16_t CRC = 0;
 
   //Protocol control word 
   if (RS485on > 0) {
     //Serial device address for RS485
-    Mess - > Control |= CR_IT_RS485;
+    Mess -> Control |= CR_IT_RS485;
   }
 
-  SendByte(Mess - > Control);
-  CalcCRC16( & CRC, Mess - > Control);
-  SendByte(Mess - > MessageID);
-  CalcCRC16( & CRC, Mess - > MessageID);
+  SendByte(Mess -> Control);
+  CalcCRC16( & CRC, Mess -> Control);
+  SendByte(Mess -> MessageID);
+  CalcCRC16( & CRC, Mess -> MessageID);
 
   if (RS485on > 0) {
     //Serial device address for RS485
@@ -305,25 +917,109 @@ void ClouRFID::SendPacket(ClouRFID_Mes_t * Mess) {
   }
 
   //Data content length 
-  if (Mess - > Len > ClouRFID_MaxDataLen) Mess - > Len = ClouRFID_MaxDataLen;
-  SendByte((uint8_t)(Mess - > Len >> 8));
-  CalcCRC16( & CRC, (uint8_t)(Mess - > Len >> 8));
-  SendByte((uint8_t)(Mess - > Len & 0xFF));
-  CalcCRC16( & CRC, (uint8_t)(Mess - > Len & 0xFF));
+  if (Mess -> Len > ClouRFID_MaxDataLen) Mess -> Len = ClouRFID_MaxDataLen;
+  SendByte((uint8_t)(Mess -> Len >> 8));
+  CalcCRC16( & CRC, (uint8_t)(Mess -> Len >> 8));
+  SendByte((uint8_t)(Mess -> Len & 0xFF));
+  CalcCRC16( & CRC, (uint8_t)(Mess -> Len & 0xFF));
 
   //Send data
-  for (uint16_t i = 0; i < Mess - > Len; i++) {
-    SendByte((uint8_t) Mess - > Data[i]);
-    CalcCRC16( & CRC, Mess - > Data[i]);
+  for (uint16_t i = 0; i < Mess -> Len; i++) {
+    SendByte((uint8_t) Mess -> Data[i]);
+    CalcCRC16( & CRC, Mess -> Data[i]);
   }
 
   //Send CRC
   SendByte((uint8_t)(CRC >> 8));
   SendByte((uint8_t)(CRC & 0xFF));
+  PortSend();
 
-  # if RFID_DEBUG_ON > 1
+  #if RFID_DEBUG_ON > 1
     USB.printf("\n");
-  # endif
+  #endif
+}
+
+//!*************************************************************
+//! Name: ParseByte()                          
+//! Description: Parse one received byte of frame
+//! Param : ClouRFID_Parser_t * Parser : pointer to parse state
+//!       : ClouRFID_Mes_t * Mess : pointer to message for receive
+//!       : uint8_t Data : received byte
+//! Returns: 0 - frame received / 0xFF - frame not complete
+//!*************************************************************
+uint8_t ClouRFID::ParseByte(ClouRFID_Parser_t * Parser, ClouRFID_Mes_t * Mess, uint8_t Data) {
+  switch (Parser -> PackState) {
+    //case 0 in default section
+  case 1: //Protocol control word MSB
+    CalcCRC16( & Parser -> CRC, Data);
+    Mess -> Control = Data;
+    Parser -> PackState++;
+    break;
+  case 2: //Protocol control word LSB
+    CalcCRC16( & Parser -> CRC, Data);
+    Mess -> MessageID = Data;
+    Parser -> PackState++;
+    if ((Mess -> Control & CR_IT_RS485) == 0) Parser -> PackState++; //Skip addres if not RS485
+    break;
+  case 3: //RS485 addres
+    CalcCRC16( & Parser -> CRC, Data);
+    Parser -> PackState++;
+    break;
+  case 4: //Data content length MSB
+    CalcCRC16( & Parser -> CRC, Data);
+    Parser -> Temp = Data;
+    Parser -> Temp <<= 8;
+    Parser -> PackState++;
+    break;
+  case 5: //Data content length LSB
+    CalcCRC16( & Parser -> CRC, Data);
+    Parser -> Temp += Data;
+    Mess -> Len = Parser -> Temp;
+    Parser -> Temp = 0;
+    Parser -> PackState++;
+    if (Mess -> Len == 0) Parser -> PackState++; //Skip data  
+    if (Mess -> Len > ClouRFID_MaxDataLen) {
+      Parser -> PackState = 0;
+      #if RFID_DEBUG_ON > 0
+      USB.printf("\nRFID ERROR packet too long %d bytes", Mess -> Len);
+      #endif
+    }
+    break;
+  case 6: //Message data 
+    CalcCRC16( & Parser -> CRC, Data);
+    Mess -> Data[Parser -> Temp] = Data;
+    Parser -> Temp++;
+    if (Parser -> Temp >= Mess -> Len) Parser -> PackState++;
+    break;
+  case 7: //СRC MSB 
+    Parser -> Temp = Data;
+    Parser -> Temp <<= 8;
+    Parser -> PackState++;
+    break;
+  case 8: //СRC LSB 
+    Parser -> Temp += Data;
+    Parser -> PackState = 0; //Ready for next frame
+    if (Parser -> Temp == Parser -> CRC) {
+      #if RFID_DEBUG_ON > 1
+      USB.printf(" CRC OK");
+      #endif
+      return 0;
+    }
+    #if RFID_DEBUG_ON > 0
+    USB.printf("\nRFID ERROR CRC %04x != %04x", Parser -> CRC, Parser -> Temp);
+    #endif
+    break;
+  default: //Frame head and wrong state
+    if (Data == CR_HEAD) {
+      Parser -> CRC = 0;
+      Parser -> PackState = 1;
+      #if RFID_DEBUG_ON > 0
+      USB.printf("\n             ");
+      #endif
+    }
+    break;
+  }
+  return 0xFF;
 }
 
 //!*************************************************************
@@ -332,104 +1028,124 @@ void ClouRFID::SendPacket(ClouRFID_Mes_t * Mess) {
 //! Param : ClouRFID_Mes_t * Mess : pointer to message for receive
 //! Returns: 0 - OK / 0xFF - FAIL/NO DATA             
 //!*************************************************************
-uint8_t ClouRFID::GetPacket(ClouRFID_Mes_t * Mess) {#
-  if RFID_DEBUG_ON > 1
-  USB.printf("\nRFID resive: ");#
-  endif
+uint8_t ClouRFID::GetPacket(ClouRFID_Mes_t * Mess) {
+  #if RFID_DEBUG_ON > 1
+  USB.printf("\nRFID resive: ");
+  #endif
   //Process FIFO
-  #
-  if RFID_DEBUG_ON > 0
-  uint8_t Line = 0;#
-  endif
+  #if RFID_DEBUG_ON > 0
+  uint8_t Line = 0;
+  #endif
   uint8_t Data = 0;
-  while (W485.available()) {
-    Data = W485.read();#
-    if RFID_DEBUG_ON > 1
+  while (PortRead( & Data) == 0) {
+    #if RFID_DEBUG_ON > 1
     USB.printf(" %02x", Data);
     Line++;
     if (Line > 16) {
       Line = 0;
       USB.printf("\n             ");
-    }#
-    endif
-    switch (PackState) {
-      //case 0 in default section
-    case 1: //Protocol control word MSB
-      CalcCRC16( & CRC, Data);
-      Mess - > Control = Data;
-      PackState++;
-      break;
-    case 2: //Protocol control word LSB
-      CalcCRC16( & CRC, Data);
-      Mess - > MessageID = Data;
-      PackState++;
-      if ((Mess - > Control & CR_IT_RS485) == 0) PackState++; //Skip addres if not RS485
-      break;
-    case 3: //RS485 addres
-      CalcCRC16( & CRC, Data);
-      PackState++;
-      break;
-    case 4: //Data content length MSB
-      CalcCRC16( & CRC, Data);
-      Temp = Data;
-      Temp <<= 8;
-      PackState++;
-      break;
-    case 5: //Data content length LSB
-      CalcCRC16( & CRC, Data);
-      Temp += Data;
-      Mess - > Len = Temp;
-      Temp = 0;
-      PackState++;
-      if (Mess - > Len == 0) PackState++; //Skip data  
-      if (Mess - > Len > ClouRFID_MaxDataLen) {
-        PackState = 0;#
-        if RFID_DEBUG_ON > 0
-        USB.printf("\nRFID ERROR packet too long %d bytes", Mess - > Len);#
-        endif
-      }
-      break;
-    case 6: //Message data 
-      CalcCRC16( & CRC, Data);
-      Mess - > Data[Temp] = Data;
-      Temp++;
-      if (Temp >= Mess - > Len) PackState++;
-      break;
-    case 7: //СRC MSB 
-      Temp = Data;
-      Temp <<= 8;
-      PackState++;
-      break;
-    case 8: //СRC LSB 
-      Temp += Data;
-      if (Temp == CRC) {#
-        if RFID_DEBUG_ON > 1
-        USB.printf(" CRC OK");#
-        endif
-        return 0;
-      }
-      PackState = 0;#
-      if RFID_DEBUG_ON > 0
-      USB.printf("\nRFID ERROR CRC %04x != %04x", CRC, Temp);#
-      endif
-      break;
-    default: //Frame head and wrong state
-      if (Data == CR_HEAD) {
-        CRC = 0;
-        PackState = 1;#
-        if RFID_DEBUG_ON > 0
-        USB.printf("\n             ");#
-        endif
-      }
-      break;
     }
+    #endif
+    if (ParseByte( & cParse, Mess, Data) == 0) return 0;
+  }
+  return 0xFF;
+}
+
+#if ClouRFID_FEED_on > 0
+//!*************************************************************
+//! Name: FeedByte()                          
+//! Description: Feed byte received from reader (interrupt safe producer): 
+//!              tag upload frames are added to FIFO, other frames are dropped
+//! Param : uint8_t Data : received byte
+//! Returns: void
+//!*************************************************************
+void ClouRFID::FeedByte(uint8_t Data) {
+  if (ParseByte( & feedParse, & feedMess, Data) != 0) return;
+  if (((feedMess.Control & CR_IT_RINI) != 0) && ((feedMess.Control & CR_MT_MASK) == CR_MT_RFID) &&
+    (feedMess.MessageID == 0)) { //EPC tag data upload
+    AddTag( & feedMess);
+    #if ClouRFID_FIFO_high > 0
+      if (FifoQty(tagFIFO_stage) >= ClouRFID_FIFO_high) { //consumer falls behind - FeedControl stops reading
+        CR_FIFO_STORE(feedPause, 1);
+      }
+    #endif //ClouRFID_FIFO_high>0
   }
-  return 0xFF;#
-  if RFID_DEBUG_ON > 1
-  USB.printf("\n");#
-  endif
 }
 
+//!*************************************************************
+//! Name: FeedStart()                          
+//! Description: Start continuous read, reader uploads tags itself (to FeedByte),
+//!              call with feeding interrupt disabled
+//! Param : uint8_t Ant : Antena ID
+//! Returns: ClouRFID_OK / ClouRFID_ERROR (ClouRFID_RETURN_t)             
+//!*************************************************************
+ClouRFID_RETURN_t ClouRFID::FeedStart(uint8_t Ant) {
+  #if (ClouRFID_TID_max_len != 0) || (ClouRFID_EPC_max_len != 0) /* +++ User data len test here */
+  if ((cParams.AntenaQty == 0) || (RS485on > 0)) return ClouRFID_ERROR; //continuous read blocks RS485 interface
+  if ((Ant == 0) || (Ant >= cParams.AntenaQty)) {
+    Ant = cParams.AntenaQty;
+  }
+  feedAnt = Ant;
+  StopRFID();
+  InventoryIni(Ant - 1);
+  ReadCommand(Ant - 1, 1); //1 - Continuous read mode: reader reads till stop command
+  SendPacket( & cMess);
+  uint8_t Ret = GetResp( & cMess);
+  FeedRest();
+  if ((Ret == 0) && (cMess.MessageID == CR_RFID_ReadEPCtag) && (cMess.Data[0] == 0)) {
+    return ClouRFID_OK;
+  }
+  #endif //(ClouRFID_TID_max_len != 0) || (ClouRFID_EPC_max_len != 0)
+  return ClouRFID_ERROR;
+}
+
+//!*************************************************************
+//! Name: FeedControl()                          
+//! Description: Flow control of continuous read (main loop, feeding interrupt disabled):
+//!              stop read requested by FeedByte at FIFO high-water mark, restart it when
+//!              FIFO has not more than ClouRFID_FIFO_low tags
+//! Param: void                         
+//! Returns: void             
+//!*************************************************************
+void ClouRFID::FeedControl() {
+  #if ClouRFID_FIFO_high > 0
+    if (tagPaused == 0) {
+      if (CR_FIFO_LOAD(feedPause) == 0) return;
+      StopRFID(); //tags uploaded before stop response go to FIFO (or lost counter)
+      FeedRest();
+      tagPaused = 1;
+      tagCycleSkip = 1;
+      tagPauseStart = millis();
+      #if RFID_DEBUG_ON > 0
+        USB.printf("\nRFID Inventory pause");
+      #endif
+      return;
+    }
+    tagCycleSkip = 1; //tags not read - no presence aging
+    if (GetTagQty() > ClouRFID_FIFO_low) return;
+    CR_FIFO_STORE(feedPause, 0);
+    if (FeedStart(feedAnt) != ClouRFID_OK) return; //try again on next call
+    tagPaused = 0;
+    tagPauseTime += millis() - tagPauseStart;
+    #if RFID_DEBUG_ON > 0
+      USB.printf("\nRFID Inventory resume");
+    #endif
+  #endif //ClouRFID_FIFO_high>0
+}
+
+//!*************************************************************
+//! Name: FeedRest()                          
+//! Description: Feed bytes received by command response wait but not parsed (Linux RX buffer)
+//! Param: void                         
+//! Returns: void             
+//!*************************************************************
+void ClouRFID::FeedRest() {
+  #if defined(__linux__)
+    while (PortRxPos < PortRxLen) FeedByte(PortRxBuf[PortRxPos++]);
+  #endif
+}
+#endif //ClouRFID_FEED_on>0
+
 //!*************************************************************
 //! Name: PortIni()                          
 //! Description: RS232/RS485 port enable
@@ -437,13 +1153,39 @@ uint8_t ClouRFID::GetPacket(ClouRFID_Mes_t * Mess) {#
 //! Returns: 0 - OK / 0xFF - FAIL             
 //!*************************************************************
 uint8_t ClouRFID::PortIni(uint32_t baudRate) {
-
-  if (W485.ON() != 0) return 0xFF;
-  W485.baudRateConfig(baudRate); // Configure the baud rate of the module
-  W485.parityBit(DISABLE); // Configure the parity bit as disabled 
-  W485.stopBitConfig(1); // Use one stop bit configuration  
-  W485.transmission(DISABLE); // Disables the transmission - sniffing the bus
-  W485.flush(); // Clear both the receive and transmit FIFOs of all data contents.
+  #if defined(__linux__)
+    static const uint32_t Speeds[][2] = {
+      {9600, B9600}, {19200, B19200}, {38400, B38400}, {57600, B57600},
+      {115200, B115200}, {230400, B230400}, {460800, B460800}, {921600, B921600}
+    };
+    speed_t Speed = 0;
+    for (uint8_t i = 0; i < sizeof(Speeds) / sizeof(Speeds[0]); i++) {
+      if (Speeds[i][0] == baudRate) Speed = Speeds[i][1];
+    }
+    if ((Speed == 0) || (PortName == NULL)) return 0xFF;
+    if (PortFd < 0) {
+      PortFd = open(PortName, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+      if (PortFd < 0) return 0xFF;
+    }
+    struct termios Tio;
+    if (tcgetattr(PortFd, & Tio) != 0) return 0xFF;
+    cfmakeraw( & Tio); // 8 data bits, no parity, raw mode
+    Tio.c_cflag &= ~(CSTOPB | CRTSCTS); // Use one stop bit configuration, no flow control
+    Tio.c_cflag |= CLOCAL | CREAD;
+    cfsetispeed( & Tio, Speed);
+    cfsetospeed( & Tio, Speed);
+    if (tcsetattr(PortFd, TCSANOW, & Tio) != 0) return 0xFF;
+    tcflush(PortFd, TCIOFLUSH); // Clear both the receive and transmit FIFOs of all data contents.
+    PortRxLen = 0;
+    PortRxPos = 0;
+  #else
+    if (W485.ON() != 0) return 0xFF;
+    W485.baudRateConfig(baudRate); // Configure the baud rate of the module
+    W485.parityBit(DISABLE); // Configure the parity bit as disabled 
+    W485.stopBitConfig(1); // Use one stop bit configuration  
+    W485.transmission(DISABLE); // Disables the transmission - sniffing the bus
+    W485.flush(); // Clear both the receive and transmit FIFOs of all data contents.
+  #endif
   return 0;
 }
 
@@ -454,44 +1196,180 @@ uint8_t ClouRFID::PortIni(uint32_t baudRate) {
 //! Returns: void            
 //!*************************************************************
 void ClouRFID::PortDeIni() {
-  W485.OFF();#
-  if RFID_DEBUG_ON > 0
-  USB.OFF();#
-  endif
+  #if defined(__linux__)
+    if (PortFd >= 0) close(PortFd);
+    PortFd = -1;
+  #else
+    W485.OFF();
+  #endif
+  #if RFID_DEBUG_ON > 0
+  USB.OFF();
+  #endif
 }
 
 //!*************************************************************
-//! Name: ErrorFilter()                          
-//! Description: Illegal command response detection
-//! Param : ClouRFID_Mes_t * Mess : pointer to message for check
-//! Returns: 0 - OK / 0xFF - Mess == illegal command response            
+//! Name: PortTX()                          
+//! Description: Switch port to transmission
+//! Param: void                         
+//! Returns: void            
 //!*************************************************************
-uint8_t ClouRFID::ErrorFilter(ClouRFID_Mes_t * Mess) {
-  if (((Mess - > Control & CR_IT_RINI) != 0) && //Means this message is initiated by reader.
-    (Mess - > MessageID == CR_ERR) && //Illegal command response
-    (Mess - > Len == 6)) { //6 bit in error message 
-    #
-    if RFID_DEBUG_ON > 0
-    USB.printf("\nRFID ERROR Illegal command %x %x %x%x %x%x",
-      Mess - > Data[0], Mess - > Data[1], Mess - > Data[2],
-      Mess - > Data[3], Mess - > Data[4], Mess - > Data[5]);#
-    endif
-    return 0xFF;
-  }
-  return 0;
+void ClouRFID::PortTX() {
+  #if defined(__linux__)
+    PortTxLen = 0; //RS485 direction is controlled by adapter
+  #else
+    W485.reception(DISABLE);
+    W485.transmission(ENABLE);
+    delay(2);
+  #endif
 }
 
 //!*************************************************************
-//! Name: StopRFID()                          
-//! Description: Stop all RFID opperations
-//! Param : void
+//! Name: PortSend()                          
+//! Description: End of frame transmission (send buffered frame)
+//! Param: void                         
 //! Returns: void            
 //!*************************************************************
-void ClouRFID::StopRFID() {
-  uint8_t Ret = 5;
-  while (Ret != 0) {
-    //stopping all RFID operations, & reader enter idle status.
-    cMess.Control = CR_MT_RFID;
+void ClouRFID::PortSend() {
+  #if defined(__linux__)
+    uint16_t Pos = 0;
+    while ((Pos < PortTxLen) && (PortFd >= 0)) {
+      ssize_t Wr = write(PortFd, & PortTxBuf[Pos], PortTxLen - Pos);
+      if (Wr > 0) {
+        Pos += Wr;
+      } else if ((Wr < 0) && (errno != EAGAIN) && (errno != EINTR)) {
+        PortLost();
+        break;
+      } else {
+        delay(1);
+      }
+    }
+    PortTxLen = 0;
+  #endif
+}
+
+//!*************************************************************
+//! Name: PortRX()                          
+//! Description: Switch port to reception
+//! Param: void                         
+//! Returns: void            
+//!*************************************************************
+void ClouRFID::PortRX() {
+  #if defined(__linux__)
+    if (PortFd >= 0) tcdrain(PortFd);
+  #else
+    W485.transmission(DISABLE);
+    W485.reception(ENABLE);
+  #endif
+}
+
+//!*************************************************************
+//! Name: PortRead()                          
+//! Description: Read one received byte
+//! Param : uint8_t * Data : pointer to byte
+//! Returns: 0 - OK / 0xFF - no data
+//!*************************************************************
+uint8_t ClouRFID::PortRead(uint8_t * Data) {
+  #if defined(__linux__)
+    if (PortRxPos >= PortRxLen) {
+      PortRxPos = 0;
+      PortRxLen = 0;
+      if (PortFd < 0) return 0xFF;
+      ssize_t Rd = read(PortFd, PortRxBuf, sizeof(PortRxBuf));
+      if ((Rd == 0) || ((Rd < 0) && (errno != EAGAIN) && (errno != EINTR))) { //EOF / I/O error
+        PortLost();
+        return 0xFF;
+      }
+      if (Rd < 0) return 0xFF;
+      PortRxLen = Rd;
+    }
+    * Data = PortRxBuf[PortRxPos++];
+  #else
+    if (!W485.available()) return 0xFF;
+    * Data = W485.read();
+  #endif
+  return 0;
+}
+
+//!*************************************************************
+//! Name: PortFlush()                          
+//! Description: Discard received data
+//! Param: void                         
+//! Returns: void            
+//!*************************************************************
+void ClouRFID::PortFlush() {
+  #if defined(__linux__)
+    if (PortFd >= 0) tcflush(PortFd, TCIFLUSH);
+    PortRxLen = 0;
+    PortRxPos = 0;
+  #else
+    while (W485.available()) W485.read();
+  #endif
+}
+
+#if defined(__linux__)
+//!*************************************************************
+//! Name: PortLost()                          
+//! Description: Close port on I/O error (device unplugged), reader must be started again
+//! Param: void                         
+//! Returns: void            
+//!*************************************************************
+void ClouRFID::PortLost() {
+  #if RFID_DEBUG_ON > 0
+    USB.printf("\nRFID ERROR port lost");
+  #endif
+  close(PortFd);
+  PortFd = -1;
+  PortRxLen = 0;
+  PortRxPos = 0;
+  cParams.AntenaQty = 0; //no scan till Start
+}
+
+//!*************************************************************
+//! Name: GetPortState()                          
+//! Description: Get state of tty port
+//! Param: void                         
+//! Returns: ClouRFID_OK - port open / ClouRFID_ERROR - port closed ( ClouRFID_RETURN_t )
+//!*************************************************************
+ClouRFID_RETURN_t ClouRFID::GetPortState() {
+  return (PortFd >= 0) ? ClouRFID_OK : ClouRFID_ERROR;
+}
+#endif //defined(__linux__)
+
+//!*************************************************************
+//! Name: ErrorFilter()                          
+//! Description: Illegal command response detection
+//! Param : ClouRFID_Mes_t * Mess : pointer to message for check
+//! Returns: 0 - OK / 0xFF - Mess == illegal command response            
+//!*************************************************************
+uint8_t ClouRFID::ErrorFilter(ClouRFID_Mes_t * Mess) {
+  if (((Mess->Control & CR_IT_RINI) != 0) && //Means this message is initiated by reader.
+    ((Mess->Control & CR_MT_MASK) == CR_MT_RERR) && //Reader error message
+    (Mess -> MessageID == CR_ERR) && //Illegal command response
+    (Mess -> Len == 6)) { //6 bit in error message 
+    #if RFID_DEBUG_ON > 0
+    USB.printf("\nRFID ERROR Illegal command %x %x %x%x %x%x",
+      Mess -> Data[0], Mess -> Data[1], Mess -> Data[2],
+      Mess -> Data[3], Mess -> Data[4], Mess -> Data[5]);
+    #endif
+    return 0xFF;
+  }
+  return 0;
+}
+
+//!*************************************************************
+//! Name: StopRFID()                          
+//! Description: Stop all RFID opperations
+//! Param : void
+//! Returns: void            
+//!*************************************************************
+void ClouRFID::StopRFID() {
+  uint8_t Ret = 5;
+  while (Ret != 0) {
+    #if defined(__linux__)
+      if (PortFd < 0) return; //port lost
+    #endif
+    //stopping all RFID operations, & reader enter idle status.
+    cMess.Control = CR_MT_RFID;
     cMess.MessageID = CR_RFID_StopCommand;
     cMess.Len = 0;
     //Send message
@@ -499,16 +1377,17 @@ void ClouRFID::StopRFID() {
     delay(100);
     //Wait for response
     if ((GetResp( & cMess) == 0) && (cMess.MessageID == CR_RFID_StopCommand)) {
-      if (cMess.Data[0] == 0) {#
-        if RFID_DEBUG_ON > 0
-        USB.printf("\nRFID Stop OK");#
-        endif
+      if (cMess.Data[0] == 0) {
+        #if RFID_DEBUG_ON > 0
+        USB.printf("\nRFID Stop OK");
+        #endif
         return;
-      }#
-      if RFID_DEBUG_ON > 0
-      USB.printf("\nRFID Stop FAIL");#
-      endif
+      }
+      #if RFID_DEBUG_ON > 0
+      USB.printf("\nRFID Stop FAIL");
+      #endif
     }
+    Ret--;
   }
   delay(200);
 }
@@ -516,20 +1395,30 @@ void ClouRFID::StopRFID() {
 //!*************************************************************
 //! Name: GetResp()                          
 //! Description: Receive response from reader
+//!              Unsolicited frames don't extend wait: reader flooding log / error
+//!              frames times out after Retry x10 ms too
 //! Param : ClouRFID_Mes_t * Mess : pointer to message 
+//!       : uint8_t Retry : wait time (x10 ms without data)
 //! Returns: 0 - response OK / 0xFF -no response            
 //!*************************************************************
-uint8_t ClouRFID::GetResp(ClouRFID_Mes_t * Mess) {
+uint8_t ClouRFID::GetResp(ClouRFID_Mes_t * Mess, uint8_t Retry) {
   //On RX
-  W485.transmission(DISABLE);
-  W485.reception(ENABLE);
-  uint8_t RetI = 5;
-  PackState = 0;
-  CRC = 0;
-  Temp = 0; //Reset parse state
+  PortRX();
+  uint8_t RetI = Retry;
+  uint32_t Begin = millis();
+  cParse.PackState = 0;
+  cParse.CRC = 0;
+  cParse.Temp = 0; //Reset parse state
   while (RetI != 0) { //response received
-    //response is walid
-    if ((GetPacket(Mess) == 0) && (!ErrorFilter(Mess))) return 0;
+    if (GetPacket(Mess) == 0) {
+      //illegal command response
+      if (ErrorFilter(Mess)) return 1;
+      //response is walid
+      if (Dispatch(Mess) == 0) return 0;
+      //unsolicited frame handled - wait for response until deadline
+      if ((uint32_t)(millis() - Begin) >= (uint32_t)(Retry) * 10UL) break;
+      continue;
+    }
     RetI--;
     delay(10);
   }
@@ -537,7 +1426,191 @@ uint8_t ClouRFID::GetResp(ClouRFID_Mes_t * Mess) {
 }
 
 //!*************************************************************
-//! Name: GetResp()                          
+//! Name: InventoryIni()                          
+//! Description: Send inventory params of antenna to reader (if changed),
+//!              reader default params are sent back if known
+//! Param : uint8_t Ant : antenna index (0..3)
+//! Returns: void            
+//!*************************************************************
+void ClouRFID::InventoryIni(uint8_t Ant) {
+  ClouRFID_Inventory_t * Inv = & cInventory[Ant];
+  if (Inv->On == 0) { //reader default params
+    if (cInvDefault.On == 0) return; //unknown - last sent params stay
+    Inv = & cInvDefault;
+  }
+  uint8_t Q = Inv->Q;
+  if (Q == ClouRFID_Q_AUTO) { //2^Q slots for tags of last round
+    Q = 0;
+    while ((Q < 15) && ((1U << Q) < RoundTags[Ant])) Q++;
+  }
+  if ((cInvApplied.On != 0) && (cInvApplied.Session == Inv->Session) &&
+    (cInvApplied.Target == Inv->Target) && (cInvApplied.Q == Q)) {
+    return; //already applied
+  }
+  cMess.Control = CR_MT_RFID;
+  cMess.MessageID = CR_RFID_ConfigBaseband;
+  cMess.Len = 6;
+  cMess.Data[0] = 2; //PID 2: default Q value
+  cMess.Data[1] = Q;
+  cMess.Data[2] = 3; //PID 3: session
+  cMess.Data[3] = Inv->Session;
+  cMess.Data[4] = 4; //PID 4: inventory flag (0 - A, 1 - B, 2 - A & B)
+  cMess.Data[5] = Inv->Target;
+  SendPacket( & cMess);
+  if ((GetResp( & cMess) == 0) && (cMess.MessageID == CR_RFID_ConfigBaseband) && (cMess.Data[0] == 0)) {
+    cInvApplied.On = 1;
+    cInvApplied.Session = Inv->Session;
+    cInvApplied.Target = Inv->Target;
+    cInvApplied.Q = Q;
+    #if RFID_DEBUG_ON > 0
+      USB.printf("\nRFID Inventory S%d T%d Q%d", cInvApplied.Session, cInvApplied.Target, Q);
+    #endif
+    return;
+  }
+  cInvApplied.On = 0;
+  #if RFID_DEBUG_ON > 0
+    USB.printf("\nRFID ERROR inventory params");
+  #endif
+}
+
+//!*************************************************************
+//! Name: ReadCommand()                          
+//! Description: Make EPC (and TID) read command frame in cMess
+//! Param : uint8_t Ant : antenna index (0..3)
+//!       : uint8_t Mode : 0 - single read (one round), 1 - continuous read (till stop)
+//! Returns: void            
+//!*************************************************************
+void ClouRFID::ReadCommand(uint8_t Ant, uint8_t Mode) {
+  #if ClouRFID_TID_max_len == 0 //EPC only mode
+  cMess.Control = CR_MT_RFID;
+  cMess.MessageID = CR_RFID_ReadEPCtag;
+  cMess.Len = 2;
+  cMess.Data[0] = (1 << Ant); //Antenna port No.
+  cMess.Data[1] = Mode; //Read mode
+    #if RFID_DEBUG_ON > 0
+    USB.printf("\nRFID Start scan EPC only  ");
+    #endif
+  #else //EPC+TID or TID mode
+    cMess.Control = CR_MT_RFID;
+  cMess.MessageID = CR_RFID_ReadEPCtag;
+  cMess.Len = 5;
+  cMess.Data[0] = (1 << Ant); //Antenna port No.
+  cMess.Data[1] = Mode; //Read mode
+  //PID 2: TID read parameter
+  cMess.Data[2] = 2; //PID Number
+  cMess.Data[3] = 0; //Byte 0: TID read mode configuration，0，TID read length self-adapter, but max. length not exceed byte 1 defined length.
+  cMess.Data[4] = (ClouRFID_TID_max_len / 2); //Byte 1：TID data word length to be read (word，16bits，below same). (6+1)*2=14 bytes
+    #if RFID_DEBUG_ON > 0
+      USB.printf("\nRFID Start scan EPC & TID");
+    #endif
+  #endif //ClouRFID_TID_max_len==0 
+
+  /* +++ User data read command here */
+
+  if (RS485on > 0) { //RS485 is on
+    cMess.Data[1] = 0; //MUST BE ZERO - continius read blocked intrface!
+  }
+}
+
+//!*************************************************************
+//! Name: OpBuild()                          
+//! Description: Make write / lock command frame of tag operation
+//! Param : ClouRFID_TagOp_t * Op : pointer to operation
+//!       : ClouRFID_Mes_t * Mess : pointer to message for send
+//! Returns: 0 - OK / 0xFF - wrong operation params or frame too long
+//!*************************************************************
+uint8_t ClouRFID::OpBuild(ClouRFID_TagOp_t * Op, ClouRFID_Mes_t * Mess) {
+  uint16_t Len = 0;
+  if ((Op->Ant == 0) || (Op->Ant > 4) || (Op->MatchArea > ClouRFID_MATCH_TID)) return 0xFF;
+  if ((Op->MatchArea != ClouRFID_MATCH_NONE) && ((Op->Match == 0) || (Op->MatchLen == 0) || (Op->MatchLen > 31))) return 0xFF;
+  Mess->Control = CR_MT_RFID;
+  Mess->Data[Len++] = 1 << (Op->Ant - 1); //Antenna port
+  switch (Op->Op) {
+  case ClouRFID_OP_WRITE_EPC:
+  case ClouRFID_OP_WRITE_USER:
+    if ((Op->Data == 0) || (Op->Len == 0) || (Op->Len & 1)) return 0xFF; //whole words only
+    if (Len + 5 + Op->Len > ClouRFID_MaxDataLen) return 0xFF;
+    Mess->MessageID = CR_RFID_WriteTag;
+    Mess->Data[Len++] = (Op->Op == ClouRFID_OP_WRITE_EPC) ? 1 : 3; //Data area: 1 - EPC, 3 - user
+    Mess->Data[Len++] = (uint8_t)(Op->Addr >> 8); //Word start address
+    Mess->Data[Len++] = (uint8_t)(Op->Addr & 0xFF);
+    Mess->Data[Len++] = 0; //Data length
+    Mess->Data[Len++] = Op->Len;
+    memcpy( & Mess->Data[Len], Op->Data, Op->Len);
+    Len += Op->Len;
+    break;
+  case ClouRFID_OP_LOCK:
+    if ((Op->LockArea > ClouRFID_LOCK_USER) || (Op->LockType > ClouRFID_LOCK_PERM_LOCK)) return 0xFF;
+    Mess->MessageID = CR_RFID_LockTag;
+    Mess->Data[Len++] = Op->LockArea;
+    Mess->Data[Len++] = Op->LockType;
+    break;
+  default:
+    return 0xFF;
+  }
+  //PID 1: match (select) parameter
+  if (Op->MatchArea != ClouRFID_MATCH_NONE) {
+    if (Len + 5 + Op->MatchLen > ClouRFID_MaxDataLen) return 0xFF;
+    uint16_t Bit = (Op->MatchArea == ClouRFID_MATCH_EPC) ? 32 : 0; //EPC starts after CRC and PC
+    Mess->Data[Len++] = 1; //PID Number
+    Mess->Data[Len++] = (Op->MatchArea == ClouRFID_MATCH_EPC) ? 1 : 2; //Match data area: 1 - EPC, 2 - TID
+    Mess->Data[Len++] = (uint8_t)(Bit >> 8); //Match start bit address
+    Mess->Data[Len++] = (uint8_t)(Bit & 0xFF);
+    Mess->Data[Len++] = Op->MatchLen * 8; //Match data bit length
+    memcpy( & Mess->Data[Len], Op->Match, Op->MatchLen);
+    Len += Op->MatchLen;
+  }
+  //PID 2: access password
+  if (Op->Password != 0) {
+    if (Len + 5 > ClouRFID_MaxDataLen) return 0xFF;
+    Mess->Data[Len++] = 2; //PID Number
+    Mess->Data[Len++] = (uint8_t)(Op->Password >> 24);
+    Mess->Data[Len++] = (uint8_t)(Op->Password >> 16);
+    Mess->Data[Len++] = (uint8_t)(Op->Password >> 8);
+    Mess->Data[Len++] = (uint8_t)(Op->Password);
+  }
+  Mess->Len = Len;
+  return 0;
+}
+
+//!*************************************************************
+//! Name: Dispatch()                          
+//! Description: Route received frame: response to pending command and tag upload
+//!              frames go to caller, tag uploads out of read command go to FIFO,
+//!              other reader initiated frames go to handlers
+//! Param : ClouRFID_Mes_t * Mess : pointer to received message
+//! Returns: 0 - frame for caller / 0xFF - frame handled or dropped
+//!*************************************************************
+uint8_t ClouRFID::Dispatch(ClouRFID_Mes_t * Mess) {
+  uint8_t Type = Mess->Control & CR_MT_MASK;
+  if ((Mess->Control & CR_IT_RINI) == 0) { //response
+    if ((Type == PendingType) && (Mess->MessageID == PendingMID)) return 0;
+    #if RFID_DEBUG_ON > 0
+      USB.printf("\nRFID unexpected response %x %x", Type, Mess->MessageID);
+    #endif
+    return 0xFF;
+  }
+  //Reader initiated frame
+  if (Type == CR_MT_RFID) {
+    if ((PendingType == CR_MT_RFID) && (PendingMID == CR_RFID_ReadEPCtag)) {
+      return 0; //tag data upload or read finish
+    }
+    if (Mess->MessageID == 0) { //tag data upload after read stop (inventory pause) - not lost
+      AddTag(Mess);
+      return 0xFF;
+    }
+  }
+  #if RFID_DEBUG_ON > 0
+    USB.printf("\nRFID reader message %x %x", Type, Mess->MessageID);
+  #endif
+  if (Handlers[Type] != 0) {
+    Handlers[Type](Mess);
+  }
+  return 0xFF;
+}
+
+//!*************************************************************
+//! Name: AddTag()                          
 //! Description: Parse EPC read response and update tag FIFO
 //! Param : ClouRFID_Mes_t * Mess : pointer to message with tag data 
 //! Returns: void           
@@ -550,9 +1623,9 @@ void ClouRFID::AddTag(ClouRFID_Mes_t * Mess) {
   ClouRFID_Tag_t Tag_Tmp;
 
   //EPC LEN
-  uint16_t Tmp_Len = Mess - > Data[0];
+  uint16_t Tmp_Len = Mess -> Data[0];
   Tmp_Len <<= 8;
-  Tmp_Len += Mess - > Data[1];
+  Tmp_Len += Mess -> Data[1];
 
   //Parse EPC
   #if ClouRFID_EPC_max_len > 0
@@ -562,118 +1635,736 @@ void ClouRFID::AddTag(ClouRFID_Mes_t * Mess) {
     temp = 0;
     index = 2;
     End = Tag_Tmp.EPC_Len > ClouRFID_EPC_max_len ? ClouRFID_EPC_max_len : Tag_Tmp.EPC_Len;
-    while ((End != 0) && (index < Mess - > Len)) {
-      Tag_Tmp.EPC[temp++] = Mess - > Data[index++];
+    while ((End != 0) && (index < Mess -> Len)) {
+      Tag_Tmp.EPC[temp++] = Mess -> Data[index++];
       End--;
     }
-  # endif //ClouRFID_EPC_max_len>0
+  #endif //ClouRFID_EPC_max_len>0
 
   //Skip EPC end & PC
   index = Tmp_Len + 2 + 2;
 
   //Read ANT
-  Tag_Tmp.Ant = Mess - > Data[index++];
+  Tag_Tmp.Ant = Mess -> Data[index++];
 
   //Read PIDs
 
-  if (Mess - > Data[index++] == 1) { //RSSI PID
-    Tag_Tmp.RSSIdBm = Mess - > Data[index++];
+  if (Mess -> Data[index++] == 1) { //RSSI PID
+    Tag_Tmp.RSSIdBm = Mess -> Data[index++];
   }
-  if (Mess - > Data[index++] == 2) { //tag data read result PID
-    if (Mess - > Data[index++] != 0) {#
-      if RFID_DEBUG_ON > 0
-      USB.printf("\nRFID ERROR tag read %02x ", cMess.Data[index]);#
-      endif
+  if (Mess -> Data[index++] == 2) { //tag data read result PID
+    if (Mess -> Data[index++] != 0) {
+      #if RFID_DEBUG_ON > 0
+      USB.printf("\nRFID ERROR tag read %02x ", Mess -> Data[index - 1]);
+      #endif
       return;
     }
   }
 
-  if (Mess - > Data[index++] == 3) { //Tag TID data  PID
-    Tmp_Len = Mess - > Data[index++];
+  //Tags read in inventory round (not uploads after read stop or fed frames)
+  if ((tagRound != 0) && (RoundQty < 0xFFFF)) RoundQty++;
+
+  if (Mess -> Data[index++] == 3) { //Tag TID data  PID
+    Tmp_Len = Mess -> Data[index++];
     Tmp_Len <<= 8;
-    Tmp_Len += Mess - > Data[index++];
-    # if ClouRFID_TID_max_len > 0
+    Tmp_Len += Mess -> Data[index++];
+    #if ClouRFID_TID_max_len > 0
       Tag_Tmp.TID_Len = Tmp_Len;
-    # endif //ClouRFID_TID_max_len>0
+    #endif //ClouRFID_TID_max_len>0
     Tmp_Len += index;
-    # if ClouRFID_TID_max_len > 0
+    #if ClouRFID_TID_max_len > 0
       End = Tag_Tmp.TID_Len > ClouRFID_TID_max_len ? ClouRFID_TID_max_len : Tag_Tmp.TID_Len;
       //Read TID
       temp = 0;
-      while ((End != 0) && (index < Mess - > Len)) {
-        Tag_Tmp.TID[temp++] = Mess - > Data[index++];
+      while ((End != 0) && (index < Mess -> Len)) {
+        Tag_Tmp.TID[temp++] = Mess -> Data[index++];
         End--;
       }
-    # endif //ClouRFID_TID_max_len>0
+    #endif //ClouRFID_TID_max_len>0
     index = Tmp_Len;
   }
 
   /* +++ User data load here */
 
-  //Find same tags in FIFO
-  if (tagFIFO_count) {
-
-    temp = tagFIFO_out;
-    uint8_t match = 0;
-    while (temp != tagFIFO_in) {
-
-      /* EPC match test */
-      # if ClouRFID_EPC_max_len > 0
-        if (tagFIFO[temp].EPC_Len == Tag_Tmp.EPC_Len) { //if EPC == 0 it not add to FIFO
-          End = Tag_Tmp.EPC_Len > ClouRFID_EPC_max_len ? ClouRFID_EPC_max_len : Tag_Tmp.EPC_Len; //number of bytes for compare
-          index = 0; //compare index
-          while (End > 0) {
-            if (Tag_Tmp.EPC[index] != tagFIFO[temp].EPC[index]) break; //compare, break if no match
-            End--;
-            index++;
-          }
-          if (End > 0) { //EPC does not match
-            temp = (temp >= ClouRFID_TAG_FIFO_len - 1) ? 0 : (temp + 1); //to next tag in FIFO
-            continue; //go to next tag in FIFO (next loop of while(temp!=tagFIFO_in) )
-          }
-        }
-      # endif //ClouRFID_EPC_max_len>0
-
-      /* TID match test */
-      # if ClouRFID_TID_max_len > 0
-        if (tagFIFO[temp].TID_Len == Tag_Tmp.TID_Len) {
-          End = Tag_Tmp.TID_Len > ClouRFID_TID_max_len ? ClouRFID_TID_max_len : Tag_Tmp.TID_Len; //number of bytes for compare
-          index = 0; //compare index
-          while (End > 0) {
-            if (Tag_Tmp.TID[index] != tagFIFO[temp].TID[index]) break; //compare, break if no match
-            End--;
-            index++;
-          }
-          if (End > 0) { //TID does not match
-            temp = (temp >= ClouRFID_TAG_FIFO_len - 1) ? 0 : (temp + 1); //to next tag in FIFO
-            continue; //go to next tag in FIFO (next loop of while(temp!=tagFIFO_in) )
-          }
-        }
-      # endif //ClouRFID_EPC_max_len>0
+  #if ClouRFID_PRESENCE_len > 0
+    uint8_t Presence = PresenceUpdate( & Tag_Tmp);
+    if (Presence == 0) { //Tag already present - no event
+      return;
+    }
+    Tag_Tmp.Event = ClouRFID_ARRIVED;
+  #endif //ClouRFID_PRESENCE_len>0
 
-      /* +++ User data match test here */
+  #if ClouRFID_FILTER_bits > 0
+    uint32_t Hash = FilterHash( & Tag_Tmp);
+    if (FilterCheck(Hash, 0) == 0) { //Tag already reported in this epoch
+      #if RFID_DEBUG_ON > 0
+        USB.printf("\nRFID tag already reported");
+      #endif
+      return;
+    }
+  #endif //ClouRFID_FILTER_bits>0
 
-      if (Tag_Tmp.RSSIdBm > tagFIFO[temp].RSSIdBm) { //better signal 
-        tagFIFO[temp].RSSIdBm = Tag_Tmp.RSSIdBm;
-        tagFIFO[temp].Ant = Tag_Tmp.Ant;
+  //Find same tags in FIFO: published cells (out to in) are owned by consumer, producer only reads them,
+  //staged cells of round (in to stage) are owned by producer, better signal of tag is kept there
+  //ARRIVED of tracked tag is always new event (older events of tag may be in FIFO)
+  temp = CR_FIFO_LOAD(tagFIFO_out);
+  #if ClouRFID_PRESENCE_len > 0
+    if (Presence == 1) temp = tagFIFO_in;
+  #endif //ClouRFID_PRESENCE_len>0
+  while (temp != tagFIFO_stage) {
+    #if ClouRFID_PRESENCE_len > 0
+      if (tagFIFO[temp].Event != Tag_Tmp.Event) { //other event of tag
+        temp = (temp >= ClouRFID_TAG_FIFO_len) ? 0 : (temp + 1);
+        continue;
+      }
+    #endif //ClouRFID_PRESENCE_len>0
+    if (TagCmp( & tagFIFO[temp], & Tag_Tmp) == 0) {
+      if (FifoQty(temp) >= FifoQty(tagFIFO_in)) { //staged cell
+        if (Tag_Tmp.RSSIdBm > tagFIFO[temp].RSSIdBm) { //better signal 
+          tagFIFO[temp].RSSIdBm = Tag_Tmp.RSSIdBm;
+          tagFIFO[temp].Ant = Tag_Tmp.Ant;
+        }
       }
-      # if RFID_DEBUG_ON > 0
+      #if RFID_DEBUG_ON > 0
         USB.printf("\nRFID EPC and/or TID match");
-      # endif
+      #endif
       return; //EPC and/or TID match - no need add tag in fifo
     }
+    temp = (temp >= ClouRFID_TAG_FIFO_len) ? 0 : (temp + 1); //to next tag in FIFO
   }
 
-  //Add tag to FIFO
-  memcpy((uint8_t * )( & tagFIFO[tagFIFO_in]), (uint8_t * )( & Tag_Tmp), sizeof(ClouRFID_Tag_t));
-  //Update in index
-  tagFIFO_in++;
-  if (tagFIFO_in >= ClouRFID_TAG_FIFO_len + 1) {
-    tagFIFO_in = 0;
+  //Add tag to FIFO (or to spill log if FIFO full)
+  if (QueueTag( & Tag_Tmp) != 0) {
+    CR_COUNT_INC(tagLost);
+    return;
   }
-  //Update data count
-  tagFIFO_count++;
-  if (tagFIFO_count > ClouRFID_TAG_FIFO_len) {
-    tagFIFO_count = ClouRFID_TAG_FIFO_len;
+  #if ClouRFID_FILTER_bits > 0
+    FilterCheck(Hash, 1); //Mark as reported
+  #endif
+}
+
+//!*************************************************************
+//! Name: TagCmp()                          
+//! Description: Compare EPC and/or TID of tags
+//! Param : ClouRFID_Tag_t * A : pointer to first tag
+//!       : ClouRFID_Tag_t * B : pointer to second tag
+//! Returns: 0 - EPC and/or TID match / 0xFF - tags differ
+//!*************************************************************
+uint8_t ClouRFID::TagCmp(ClouRFID_Tag_t * A, ClouRFID_Tag_t * B) {
+  uint16_t Len;
+
+  /* EPC match test */
+  #if ClouRFID_EPC_max_len > 0
+    if (A->EPC_Len != B->EPC_Len) return 0xFF;
+    Len = A->EPC_Len > ClouRFID_EPC_max_len ? ClouRFID_EPC_max_len : A->EPC_Len; //number of bytes for compare
+    if (memcmp(A->EPC, B->EPC, Len) != 0) return 0xFF;
+  #endif //ClouRFID_EPC_max_len>0
+
+  /* TID match test */
+  #if ClouRFID_TID_max_len > 0
+    if (A->TID_Len != B->TID_Len) return 0xFF;
+    Len = A->TID_Len > ClouRFID_TID_max_len ? ClouRFID_TID_max_len : A->TID_Len; //number of bytes for compare
+    if (memcmp(A->TID, B->TID, Len) != 0) return 0xFF;
+  #endif //ClouRFID_TID_max_len>0
+
+  /* +++ User data match test here */
+
+  return 0;
+}
+
+//!*************************************************************
+//! Name: PushTag()                          
+//! Description: Put tag to FIFO (producer side)
+//! Param : ClouRFID_Tag_t * Tag : pointer to tag for add
+//! Returns: 0 - OK / 0xFF - FIFO full, tag lost
+//!*************************************************************
+uint8_t ClouRFID::PushTag(ClouRFID_Tag_t * Tag) {
+  uint8_t In_i = tagFIFO_stage;
+  uint8_t Next = (In_i >= ClouRFID_TAG_FIFO_len) ? 0 : (In_i + 1);
+  if (Next == CR_FIFO_LOAD(tagFIFO_out)) { //FIFO full
+    #if RFID_DEBUG_ON > 0
+      USB.printf("\nRFID ERROR tag FIFO full");
+    #endif
+    return 0xFF;
   }
-}
+  memcpy((uint8_t * )( & tagFIFO[In_i]), (uint8_t * )(Tag), sizeof(ClouRFID_Tag_t));
+  tagFIFO_stage = Next;
+  //Tag out of round is published at once (with staged tags before it)
+  if (tagRound == 0) CR_FIFO_STORE(tagFIFO_in, Next);
+  return 0;
+}
+
+//!*************************************************************
+//! Name: PublishTags()                          
+//! Description: End of round: publish staged tags to consumer (producer side)
+//! Param: void                         
+//! Returns: void             
+//!*************************************************************
+void ClouRFID::PublishTags() {
+  tagRound = 0;
+  if (tagFIFO_in != tagFIFO_stage) CR_FIFO_STORE(tagFIFO_in, tagFIFO_stage);
+}
+
+//!*************************************************************
+//! Name: FifoQty()                          
+//! Description: Quantity of tags in FIFO from out index up to cell index
+//! Param : uint8_t In : cell index (tagFIFO_in - published tags, tagFIFO_stage - with staged ones)
+//! Returns: quantity of tags
+//!*************************************************************
+uint16_t ClouRFID::FifoQty(uint8_t In) {
+  uint8_t Out_i = CR_FIFO_LOAD(tagFIFO_out);
+  return (In >= Out_i) ? (In - Out_i) : (In + ClouRFID_TAG_FIFO_len + 1 - Out_i);
+}
+
+//!*************************************************************
+//! Name: QueueTag()                          
+//! Description: Put tag to FIFO or to spill log buffer if FIFO is full,
+//!              till spill log replay all next tags go to log (read order)
+//! Param : ClouRFID_Tag_t * Tag : pointer to tag for add
+//! Returns: 0 - OK / 0xFF - FIFO and spill buffers full, tag lost
+//!*************************************************************
+uint8_t ClouRFID::QueueTag(ClouRFID_Tag_t * Tag) {
+  #if ClouRFID_SPILL_batch > 0
+    if (spillOn == 0) {
+      if (PushTag(Tag) == 0) return 0;
+      spillOn = 1;
+    }
+    return SpillTag(Tag);
+  #else
+    return PushTag(Tag);
+  #endif //ClouRFID_SPILL_batch>0
+}
+
+//!*************************************************************
+//! Name: PresenceUpdate()                          
+//! Description: Update presence table by read tag
+//! Param : ClouRFID_Tag_t * Tag : pointer to read tag
+//! Returns: 0 - tag already present / 1 - new tag (ARRIVED) / 0xFF - new tag, table full (ARRIVED)
+//!*************************************************************
+uint8_t ClouRFID::PresenceUpdate(ClouRFID_Tag_t * Tag) {
+  #if ClouRFID_PRESENCE_len > 0
+    uint8_t Free = ClouRFID_PRESENCE_len;
+    for (uint8_t i = 0; i < ClouRFID_PRESENCE_len; i++) {
+      if (tagPresence[i].Miss == 0) { //free cell
+        if (Free == ClouRFID_PRESENCE_len) Free = i;
+        continue;
+      }
+      if (TagCmp( & tagPresence[i].Tag, Tag) == 0) {
+        if ((tagPresence[i].Miss != 1) || (Tag->RSSIdBm > tagPresence[i].Tag.RSSIdBm)) { //first read in cycle or better signal
+          tagPresence[i].Tag.RSSIdBm = Tag->RSSIdBm;
+          tagPresence[i].Tag.Ant = Tag->Ant;
+        }
+        tagPresence[i].Miss = 1;
+        return 0;
+      }
+    }
+    if (Free < ClouRFID_PRESENCE_len) {
+      memcpy((uint8_t * )( & tagPresence[Free].Tag), (uint8_t * )(Tag), sizeof(ClouRFID_Tag_t));
+      tagPresence[Free].Miss = 1;
+      tagPresence[Free].Age = 0;
+      return 1;
+    }
+    #if RFID_DEBUG_ON > 0
+      USB.printf("\nRFID presence table full");
+    #endif
+  #endif //ClouRFID_PRESENCE_len>0
+  return 0xFF;
+}
+
+//!*************************************************************
+//! Name: FilterHash()                          
+//! Description: Calculate filter hash (FNV-1a with final mix) of tag EPC and/or TID
+//! Param : ClouRFID_Tag_t * Tag : pointer to tag
+//! Returns: 32 bit hash
+//!*************************************************************
+uint32_t ClouRFID::FilterHash(ClouRFID_Tag_t * Tag) {
+  uint32_t Hash = 2166136261UL;
+  uint16_t Len;
+  #if ClouRFID_EPC_max_len > 0
+    Len = Tag->EPC_Len > ClouRFID_EPC_max_len ? ClouRFID_EPC_max_len : Tag->EPC_Len;
+    for (uint16_t i = 0; i < Len; i++) {
+      Hash = (Hash ^ Tag->EPC[i]) * 16777619UL;
+    }
+  #endif //ClouRFID_EPC_max_len>0
+  #if ClouRFID_TID_max_len > 0
+    Len = Tag->TID_Len > ClouRFID_TID_max_len ? ClouRFID_TID_max_len : Tag->TID_Len;
+    for (uint16_t i = 0; i < Len; i++) {
+      Hash = (Hash ^ Tag->TID[i]) * 16777619UL;
+    }
+  #endif //ClouRFID_TID_max_len>0
+  //Final mix (murmur3): low bits of FNV-1a depend on low bits of data only, filter index uses low bits
+  Hash ^= Hash >> 16;
+  Hash *= 0x85EBCA6BUL;
+  Hash ^= Hash >> 13;
+  Hash *= 0xC2B2AE35UL;
+  Hash ^= Hash >> 16;
+  return Hash;
+}
+
+//!*************************************************************
+//! Name: FilterCheck()                          
+//! Description: Test (and add) tag hash in "already reported" filter
+//!              bit i = h1 + i * h2 (double hashing)
+//! Param : uint32_t Hash : tag hash (FilterHash)
+//!       : uint8_t Add : 0 - test only / 1 - set bits of tag
+//! Returns: 0 - all bits set (tag reported) / 0xFF - new tag
+//!*************************************************************
+uint8_t ClouRFID::FilterCheck(uint32_t Hash, uint8_t Add) {
+  uint8_t Ret = 0;
+  #if ClouRFID_FILTER_bits > 0
+    uint16_t Bit = (uint16_t)(Hash);
+    uint16_t Step = (uint16_t)(Hash >> 16) | 1;
+    for (uint8_t i = 0; i < ClouRFID_FILTER_k; i++) {
+      uint16_t Index = Bit & (ClouRFID_FILTER_bits - 1);
+      uint8_t Mask = 1 << (Index & 7);
+      if ((tagFilter[Index >> 3] & Mask) == 0) {
+        Ret = 0xFF;
+        if (Add) {
+          tagFilter[Index >> 3] |= Mask;
+          tagFilter_set++;
+        }
+      }
+      Bit += Step;
+    }
+  #endif //ClouRFID_FILTER_bits>0
+  return Ret;
+}
+
+//!*************************************************************
+//! Name: SpillTag()                          
+//! Description: Put tag to spill log write buffer (no file access),
+//!              if buffer is full filling goes to other buffer (if written)
+//! Param : ClouRFID_Tag_t * Tag : pointer to tag
+//! Returns: 0 - OK / 0xFF - buffers full, tag lost
+//!*************************************************************
+uint8_t ClouRFID::SpillTag(ClouRFID_Tag_t * Tag) {
+  #if ClouRFID_SPILL_batch > 0
+    for (uint8_t b = 0; b < 2; b++) { //same tag already in buffers - keep better signal
+      for (uint8_t i = 0; i < spillCount[b]; i++) {
+        ClouRFID_Tag_t * Rec = (ClouRFID_Tag_t * )( & spillBuf[b][i * ClouRFID_SPILL_rec_len]);
+        if (TagCmp(Rec, Tag) != 0) continue;
+        if (Tag->RSSIdBm > Rec->RSSIdBm) {
+          Rec->RSSIdBm = Tag->RSSIdBm;
+          Rec->Ant = Tag->Ant;
+        }
+        return 0;
+      }
+    }
+    if (spillCount[spillAct] >= ClouRFID_SPILL_batch) {
+      if (spillCount[spillAct ^ 1] != 0) { //other buffer is not written yet
+        #if RFID_DEBUG_ON > 0
+          USB.printf("\nRFID ERROR spill buffer full");
+        #endif
+        return 0xFF;
+      }
+      spillAct ^= 1;
+    }
+    uint8_t * Rec = & spillBuf[spillAct][spillCount[spillAct] * ClouRFID_SPILL_rec_len];
+    memcpy(Rec, (uint8_t * )(Tag), sizeof(ClouRFID_Tag_t));
+    memset(Rec + sizeof(ClouRFID_Tag_t), 0, ClouRFID_SPILL_rec_len - sizeof(ClouRFID_Tag_t));
+    spillCount[spillAct]++;
+    return 0;
+  #else
+    return 0xFF;
+  #endif //ClouRFID_SPILL_batch>0
+}
+
+//!*************************************************************
+//! Name: SpillRec()                          
+//! Description: Pointer to record of spill buffers in read order
+//!              (buffer not being filled is older)
+//! Param : uint16_t Index : record index
+//! Returns: pointer to record
+//!*************************************************************
+uint8_t * ClouRFID::SpillRec(uint16_t Index) {
+  #if ClouRFID_SPILL_batch > 0
+    uint8_t Old = spillAct ^ 1;
+    if (Index < spillCount[Old]) return & spillBuf[Old][Index * ClouRFID_SPILL_rec_len];
+    return & spillBuf[spillAct][(Index - spillCount[Old]) * ClouRFID_SPILL_rec_len];
+  #else
+    return 0;
+  #endif //ClouRFID_SPILL_batch>0
+}
+
+//!*************************************************************
+//! Name: SpillSync()                          
+//! Description: Write FIFO tags and spill buffers to log in read order
+//!              (FIFO tags are older than buffered ones) by whole blocks,
+//!              rest of records is kept in buffer being filled
+//! Param : uint8_t Fifo : 1 - move FIFO tags to log (caller is consumer) / 
+//!                        0 - write buffers only if FIFO is empty
+//! Returns: 0 - OK / 0xFF - log write fail
+//!*************************************************************
+uint8_t ClouRFID::SpillSync(uint8_t Fifo) {
+  #if ClouRFID_SPILL_batch > 0
+    uint8_t Rec[ClouRFID_SPILL_rec_len];
+    uint8_t Out_i = tagFIFO_out;
+    uint16_t Fq = 0; //FIFO tags to move
+    if (Fifo) {
+      Fq = GetTagQty();
+    } else if (GetTagQty() != 0) {
+      return 0; //older tags in FIFO
+    }
+    uint16_t Bq = spillCount[0] + spillCount[1];
+    uint16_t Wr = (Fq + Bq) / ClouRFID_SPILL_batch * ClouRFID_SPILL_batch; //records of whole blocks
+    memset(Rec, 0, sizeof(Rec));
+    //Write whole blocks: FIFO tags, then buffered ones
+    if (Wr > 0) {
+      if (SpillOpen(CR_SPILL_WRITE) != 0) return 0xFF;
+      for (uint16_t i = 0; i < Wr; i++) {
+        uint8_t * Data;
+        if (i < Fq) {
+          memcpy(Rec, (uint8_t * )( & tagFIFO[(Out_i + i) % (ClouRFID_TAG_FIFO_len + 1)]), sizeof(ClouRFID_Tag_t));
+          Data = Rec;
+        } else {
+          Data = SpillRec(i - Fq);
+        }
+        if (SpillWrite(Data, ClouRFID_SPILL_rec_len) != 0) {
+          SpillClose();
+          return 0xFF;
+        }
+      }
+      if (SpillClose() != 0) return 0xFF;
+    }
+    //Rest of records to buffer being filled (less than one block)
+    uint8_t Old = spillAct ^ 1;
+    uint8_t * Act = spillBuf[spillAct];
+    if (Wr < Fq) { //rest of FIFO tags before buffered ones (older buffer is empty)
+      uint16_t Rest = Fq - Wr;
+      memmove( & Act[Rest * ClouRFID_SPILL_rec_len], Act, spillCount[spillAct] * ClouRFID_SPILL_rec_len);
+      for (uint16_t i = 0; i < Rest; i++) {
+        memcpy( & Act[i * ClouRFID_SPILL_rec_len], (uint8_t * )( & tagFIFO[(Out_i + Wr + i) % (ClouRFID_TAG_FIFO_len + 1)]), sizeof(ClouRFID_Tag_t));
+        memset( & Act[i * ClouRFID_SPILL_rec_len + sizeof(ClouRFID_Tag_t)], 0, ClouRFID_SPILL_rec_len - sizeof(ClouRFID_Tag_t));
+      }
+      spillCount[spillAct] += Rest;
+    } else {
+      uint16_t Done = Wr - Fq; //written buffered records
+      uint16_t Rest = Bq - Done;
+      if (Done < spillCount[Old]) { //rest of older buffer before records of buffer being filled
+        memmove( & Act[(spillCount[Old] - Done) * ClouRFID_SPILL_rec_len], Act, spillCount[spillAct] * ClouRFID_SPILL_rec_len);
+        memcpy(Act, & spillBuf[Old][Done * ClouRFID_SPILL_rec_len], (spillCount[Old] - Done) * ClouRFID_SPILL_rec_len);
+      } else {
+        memmove(Act, & Act[(Done - spillCount[Old]) * ClouRFID_SPILL_rec_len], Rest * ClouRFID_SPILL_rec_len);
+      }
+      spillCount[Old] = 0;
+      spillCount[spillAct] = Rest;
+    }
+    //Release moved FIFO cells
+    if (Fq > 0) {
+      CR_FIFO_STORE(tagFIFO_out, (Out_i + Fq) % (ClouRFID_TAG_FIFO_len + 1));
+      spillOn = 1; //log continues FIFO - next tags to log
+    }
+    return 0;
+  #else
+    return 0xFF;
+  #endif //ClouRFID_SPILL_batch>0
+}
+
+//!*************************************************************
+//! Name: SpillOpen()                          
+//! Description: Open spill log file (SD card or regular file on Linux) for replay
+//!              (from replay offset) or append, file is kept open till mode change or close
+//! Param : uint8_t Mode : CR_SPILL_READ / CR_SPILL_WRITE
+//! Returns: 0 - OK / 0xFF - FAIL
+//!*************************************************************
+uint8_t ClouRFID::SpillOpen(uint8_t Mode) {
+  #if ClouRFID_SPILL_batch > 0
+    if (spillMode == Mode) return 0;
+    SpillClose();
+    #if defined(__linux__)
+      spillFile = fopen(ClouRFID_SPILL_file, (Mode == CR_SPILL_WRITE) ? "ab" : "rb");
+      if (spillFile == NULL) return 0xFF;
+      spillMode = Mode;
+      if ((Mode == CR_SPILL_READ) && (fseek(spillFile, spillRead, SEEK_SET) != 0)) {
+        SpillClose();
+        return 0xFF;
+      }
+    #else
+      if (Mode == CR_SPILL_WRITE) {
+        if (SD.openFile(ClouRFID_SPILL_file, & CR_SpillFile, O_WRITE | O_CREAT | O_APPEND) != 1) return 0xFF;
+      } else {
+        if (SD.openFile(ClouRFID_SPILL_file, & CR_SpillFile, O_READ) != 1) return 0xFF;
+      }
+      spillMode = Mode;
+      if ((Mode == CR_SPILL_READ) && !CR_SpillFile.seekSet(spillRead)) {
+        SpillClose();
+        return 0xFF;
+      }
+    #endif
+    return 0;
+  #else
+    return 0xFF;
+  #endif //ClouRFID_SPILL_batch>0
+}
+
+//!*************************************************************
+//! Name: SpillClose()                          
+//! Description: Close spill log file (written data is flushed)
+//! Param: void                         
+//! Returns: 0 - OK / 0xFF - FAIL (write not completed)
+//!*************************************************************
+uint8_t ClouRFID::SpillClose() {
+  uint8_t Ret = 0;
+  #if ClouRFID_SPILL_batch > 0
+    if (spillMode == 0) return 0;
+    #if defined(__linux__)
+      if (fclose(spillFile) != 0) Ret = 0xFF;
+      spillFile = NULL;
+    #else
+      if (SD.closeFile( & CR_SpillFile) != 1) Ret = 0xFF;
+    #endif
+    spillMode = 0;
+  #endif //ClouRFID_SPILL_batch>0
+  return Ret;
+}
+
+//!*************************************************************
+//! Name: SpillWrite()                          
+//! Description: Append data to open spill log file
+//! Param : uint8_t * Data : pointer to data
+//!       : uint16_t Len : data length
+//! Returns: 0 - OK / 0xFF - FAIL
+//!*************************************************************
+uint8_t ClouRFID::SpillWrite(uint8_t * Data, uint16_t Len) {
+  #if ClouRFID_SPILL_batch > 0
+    #if defined(__linux__)
+      if (fwrite(Data, 1, Len, spillFile) == Len) return 0;
+    #else
+      if (CR_SpillFile.write(Data, Len) == (int16_t) Len) return 0;
+    #endif
+    #if RFID_DEBUG_ON > 0
+      USB.printf("\nRFID ERROR spill log write");
+    #endif
+  #endif //ClouRFID_SPILL_batch>0
+  return 0xFF;
+}
+
+//!*************************************************************
+//! Name: SpillRead()                          
+//! Description: Read next data from open spill log file
+//! Param : uint8_t * Data : pointer to buffer
+//!       : uint16_t Len : data length
+//! Returns: 0 - OK / 0xFF - FAIL or end of file
+//!*************************************************************
+uint8_t ClouRFID::SpillRead(uint8_t * Data, uint16_t Len) {
+  #if ClouRFID_SPILL_batch > 0
+    #if defined(__linux__)
+      if (fread(Data, 1, Len, spillFile) == Len) return 0;
+    #else
+      if (CR_SpillFile.read(Data, Len) == (int16_t) Len) return 0;
+    #endif
+  #endif //ClouRFID_SPILL_batch>0
+  return 0xFF;
+}
+
+#if defined(__linux__)
+/***********************************************************************
+ * Methods of the Gateway Class (Linux)
+ ***********************************************************************/
+
+ClouRFID_Gateway::ClouRFID_Gateway() {
+  ReaderQty = 0;
+  Run = 0;
+  Queue_in = 0;
+  Queue_count = 0;
+  Lost = 0;
+  Cycles = 0;
+  pthread_mutex_init( & Lock, NULL);
+  pthread_condattr_t Attr;
+  pthread_condattr_init( & Attr);
+  pthread_condattr_setclock( & Attr, CLOCK_MONOTONIC); //timeout not changed by wall clock step (NTP)
+  pthread_cond_init( & Ready, & Attr);
+  pthread_condattr_destroy( & Attr);
+}
+
+ClouRFID_Gateway::~ClouRFID_Gateway() {
+  Stop();
+  for (uint8_t i = 0; i < ReaderQty; i++) {
+    delete Readers[i].Reader;
+  }
+  pthread_cond_destroy( & Ready);
+  pthread_mutex_destroy( & Lock);
+}
+
+//!*************************************************************
+//! Name: AddReader()                          
+//! Description: Add reader to gateway (before Start)
+//! Param : const char * Device : tty device name
+//!       : uint32_t Baudrate : speed of port (bits / sec)
+//!       : ClouRFID_Interface_t Intrface : RS485 /  RS232
+//!       : uint8_t RS485addres : addres on RS485 bus                            
+//! Returns: ClouRFID_OK / ClouRFID_ERROR (ClouRFID_RETURN_t)             
+//!*************************************************************
+ClouRFID_RETURN_t ClouRFID_Gateway::AddReader(const char * Device, uint32_t Baudrate, ClouRFID_Interface_t Intrface, uint8_t RS485addres) {
+  if ((ReaderQty >= ClouRFID_GW_readers) || Run) return ClouRFID_ERROR;
+  ClouRFID_GwReader_t * R = & Readers[ReaderQty];
+  R->Reader = new ClouRFID();
+  R->Device = Device;
+  R->Baudrate = Baudrate;
+  R->Intrface = Intrface;
+  R->RS485addres = RS485addres;
+  R->Number = ReaderQty;
+  R->Gateway = this;
+  ReaderQty++;
+  return ClouRFID_OK;
+}
+
+//!*************************************************************
+//! Name: Start()                          
+//! Description: Start scan on all readers (one thread per reader)
+//! Param: void                         
+//! Returns: ClouRFID_OK / ClouRFID_ERROR (ClouRFID_RETURN_t)             
+//!*************************************************************
+ClouRFID_RETURN_t ClouRFID_Gateway::Start() {
+  if (Run || (ReaderQty == 0)) return ClouRFID_ERROR;
+  __atomic_store_n( & Run, 1, __ATOMIC_RELEASE);
+  for (uint8_t i = 0; i < ReaderQty; i++) {
+    if (pthread_create( & Readers[i].Thread, NULL, ReaderThread, & Readers[i]) != 0) {
+      __atomic_store_n( & Run, 0, __ATOMIC_RELEASE);
+      while (i > 0) {
+        i--;
+        pthread_join(Readers[i].Thread, NULL);
+      }
+      return ClouRFID_ERROR;
+    }
+  }
+  return ClouRFID_OK;
+}
+
+//!*************************************************************
+//! Name: Stop()                          
+//! Description: Stop scan on all readers
+//! Param: void                         
+//! Returns: void             
+//!*************************************************************
+void ClouRFID_Gateway::Stop() {
+  if (!Run) return;
+  __atomic_store_n( & Run, 0, __ATOMIC_RELEASE);
+  for (uint8_t i = 0; i < ReaderQty; i++) {
+    pthread_join(Readers[i].Thread, NULL);
+  }
+}
+
+//!*************************************************************
+//! Name: GetTag()                          
+//! Description: Get tag from merged queue
+//! Param : ClouRFID_GwTag_t * Out : pointer to reading ClouRFID_GwTag_t
+//!       : uint32_t Timeout : max wait time (ms), 0 - no wait
+//! Returns: ClouRFID_OK / ClouRFID_ERROR ( ClouRFID_RETURN_t )             
+//!*************************************************************
+ClouRFID_RETURN_t ClouRFID_Gateway::GetTag(ClouRFID_GwTag_t * Out, uint32_t Timeout) {
+  struct timespec End;
+  clock_gettime(CLOCK_MONOTONIC, & End);
+  End.tv_sec += Timeout / 1000;
+  End.tv_nsec += (Timeout % 1000) * 1000000L;
+  if (End.tv_nsec >= 1000000000L) {
+    End.tv_sec++;
+    End.tv_nsec -= 1000000000L;
+  }
+  pthread_mutex_lock( & Lock);
+  while ((Queue_count == 0) && (Timeout > 0)) {
+    if (pthread_cond_timedwait( & Ready, & Lock, & End) != 0) break;
+  }
+  if (Queue_count == 0) {
+    pthread_mutex_unlock( & Lock);
+    return ClouRFID_ERROR;
+  }
+  uint32_t Out_i = (Queue_in + ClouRFID_GW_QUEUE_len - Queue_count) % ClouRFID_GW_QUEUE_len;
+  memcpy(Out, & Queue[Out_i], sizeof(ClouRFID_GwTag_t));
+  Queue_count--;
+  pthread_mutex_unlock( & Lock);
+  return ClouRFID_OK;
+}
+
+//!*************************************************************
+//! Name: GetTagQty()                          
+//! Description: Get quantity of tags in merged queue
+//! Param: void                         
+//! Returns: quantity of tags in queue             
+//!*************************************************************
+uint32_t ClouRFID_Gateway::GetTagQty() {
+  pthread_mutex_lock( & Lock);
+  uint32_t Ret = Queue_count;
+  pthread_mutex_unlock( & Lock);
+  return Ret;
+}
+
+//!*************************************************************
+//! Name: GetLostQty()                          
+//! Description: Get quantity of tags lost (merged queue full)
+//! Param: void                         
+//! Returns: quantity of lost tags
+//!*************************************************************
+uint32_t ClouRFID_Gateway::GetLostQty() {
+  pthread_mutex_lock( & Lock);
+  uint32_t Ret = Lost;
+  pthread_mutex_unlock( & Lock);
+  return Ret;
+}
+
+//!*************************************************************
+//! Name: GetCycleQty()                          
+//! Description: Get quantity of scan cycles on all readers
+//! Param: void                         
+//! Returns: quantity of scan cycles
+//!*************************************************************
+uint32_t ClouRFID_Gateway::GetCycleQty() {
+  pthread_mutex_lock( & Lock);
+  uint32_t Ret = Cycles;
+  pthread_mutex_unlock( & Lock);
+  return Ret;
+}
+
+//!*************************************************************
+//! Name: PushTag()                          
+//! Description: Put tag to merged queue
+//! Param : ClouRFID_GwTag_t * Tag : pointer to tag
+//! Returns: void
+//!*************************************************************
+void ClouRFID_Gateway::PushTag(ClouRFID_GwTag_t * Tag) {
+  pthread_mutex_lock( & Lock);
+  if (Queue_count >= ClouRFID_GW_QUEUE_len) {
+    Lost++;
+  } else {
+    memcpy( & Queue[Queue_in], Tag, sizeof(ClouRFID_GwTag_t));
+    Queue_in = (Queue_in + 1) % ClouRFID_GW_QUEUE_len;
+    Queue_count++;
+    pthread_cond_signal( & Ready);
+  }
+  pthread_mutex_unlock( & Lock);
+}
+
+//!*************************************************************
+//! Name: ReaderThread()                          
+//! Description: Reader thread: connect, scan all antennas, move tags to merged queue,
+//!              reconnect if port is lost
+//! Param : void * Arg : pointer to ClouRFID_GwReader_t
+//! Returns: NULL
+//!*************************************************************
+void * ClouRFID_Gateway::ReaderThread(void * Arg) {
+  ClouRFID_GwReader_t * R = (ClouRFID_GwReader_t * )(Arg);
+  ClouRFID_Gateway * Gw = R->Gateway;
+  ClouRFID_GwTag_t Tag;
+  Tag.Reader = R->Number;
+  while (__atomic_load_n( & Gw->Run, __ATOMIC_ACQUIRE)) {
+    if (R->Reader->Start(R->Device, R->Baudrate, R->Intrface, R->RS485addres) != ClouRFID_OK) {
+      delay(1000); //reader not connected - retry
+      continue;
+    }
+    //Scan till stop or port lost (device unplugged) - then reconnect
+    while (__atomic_load_n( & Gw->Run, __ATOMIC_ACQUIRE) && (R->Reader->GetPortState() == ClouRFID_OK)) {
+      uint8_t Ant_Qty = R->Reader->GetAntQty();
+      for (uint8_t ant = 1; ant <= Ant_Qty; ant++) R->Reader->ScanTags(ant);
+      R->Reader->EndCycle();
+      while (R->Reader->GetTag( & Tag.Tag) == ClouRFID_OK) {
+        Gw->PushTag( & Tag);
+      }
+      pthread_mutex_lock( & Gw->Lock);
+      Gw->Cycles++;
+      pthread_mutex_unlock( & Gw->Lock);
+    }
+    R->Reader->Stop();
+  }
+  return NULL;
+}
+#endif //defined(__linux__)
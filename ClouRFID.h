@@ -22,6 +22,7 @@
  *  4. Adjast ClouRFID_MaxDataLen, it must be greater than the maximum size of EPC (EPC is always read fully) + ClouRFID_TID_max_len + 15
  *  5. Disable debug messages (RFID_DEBUG_ON to 0)
  * Default values optmazed for 96 bit EPC and 96 bit TID
+ * All values may be set before include of ClouRFID.h (compiler -D options on Linux)
  */
 
 /*! 
@@ -31,42 +32,199 @@
  *  1: debug mode enabled for high level output messages
  *  2: debug mode enabled for high and low level output messages
  */
-#define RFID_DEBUG_ON         0                          
+#ifndef RFID_DEBUG_ON
+  #define RFID_DEBUG_ON         0
+#endif
 /*! 
  * \def ClouRFID_EPC_max_len 
  * \brief Len of EPC code - 96bits / 12 bytes
  */
-#define ClouRFID_EPC_max_len  12 
+#ifndef ClouRFID_EPC_max_len
+  #define ClouRFID_EPC_max_len  12
+#endif
 
 /*! 
  * \def ClouRFID_TID_max_len 
  * \brief Len of TID code - 96bits / 12 bytes
  */                         
-#define ClouRFID_TID_max_len  12  
+#ifndef ClouRFID_TID_max_len
+  #define ClouRFID_TID_max_len  12
+#endif
 
 /*! 
  * \def ClouRFID_MaxDataLen 
  * \brief Max len of data in message
  * It must be greater than the maximum size of EPC (EPC is always read fully) + ClouRFID_TID_max_len + 15 
  */  
-#define ClouRFID_MaxDataLen   12+ClouRFID_TID_max_len+15  
+#ifndef ClouRFID_MaxDataLen
+  #define ClouRFID_MaxDataLen   12+ClouRFID_TID_max_len+15
+#endif
 
 /*! 
  * \def ClouRFID_TAG_FIFO_len 
- * \brief Qty of EPC tags
+ * \brief Qty of EPC tags (max 254)
+ */ 
+#ifndef ClouRFID_TAG_FIFO_len
+  #define ClouRFID_TAG_FIFO_len 20
+#endif
+
+/*! 
+ * \def ClouRFID_FIFO_high 
+ * \brief FIFO high-water mark: stop inventory if FIFO has this qty of tags (0 - flow control disabled)
+ */ 
+#ifndef ClouRFID_FIFO_high
+  #define ClouRFID_FIFO_high 0
+#endif
+
+/*! 
+ * \def ClouRFID_FIFO_low 
+ * \brief FIFO low-water mark: resume paused inventory if FIFO has not more than this qty of tags
+ */ 
+#ifndef ClouRFID_FIFO_low
+  #define ClouRFID_FIFO_low (ClouRFID_TAG_FIFO_len/2)
+#endif
+
+/*! 
+ * \def ClouRFID_FEED_on 
+ * \brief Byte feed producer FeedByte (reader data from UART RX interrupt), RAM usage one frame (0 - disabled)
  */ 
-#define ClouRFID_TAG_FIFO_len 20                          
+#ifndef ClouRFID_FEED_on
+  #define ClouRFID_FEED_on 0
+#endif
+
+/*! 
+ * \def ClouRFID_OP_timeout 
+ * \brief Max time of tag write / lock operation (ms, max 2550)
+ */ 
+#ifndef ClouRFID_OP_timeout
+  #define ClouRFID_OP_timeout 1000
+#endif
+
+/*! 
+ * \def ClouRFID_OP_depth 
+ * \brief Qty of tag operation commands sent before result (RS232)
+ * Waspmote RS485 module disables reception while transmitting, so no pipelining
+ */ 
+#ifndef ClouRFID_OP_depth
+  #if defined(__linux__)
+    #define ClouRFID_OP_depth 2
+  #else
+    #define ClouRFID_OP_depth 1
+  #endif
+#endif
+
+/*! 
+ * \def ClouRFID_PRESENCE_len 
+ * \brief Qty of tags in presence table (0 - presence tracking disabled)
+ * With presence tracking GetTag returns only ARRIVED / DEPARTED / PRESENT events (see EndCycle)
+ */ 
+#ifndef ClouRFID_PRESENCE_len
+  #define ClouRFID_PRESENCE_len 0
+#endif
+
+/*! 
+ * \def ClouRFID_PRESENCE_miss 
+ * \brief Qty of scan cycles without tag read before DEPARTED event (1..250)
+ */ 
+#ifndef ClouRFID_PRESENCE_miss
+  #define ClouRFID_PRESENCE_miss 3
+#endif
+
+/*! 
+ * \def ClouRFID_PRESENCE_heartbeat 
+ * \brief Qty of scan cycles between PRESENT events of tag (0 - heartbeat disabled)
+ */ 
+#ifndef ClouRFID_PRESENCE_heartbeat
+  #define ClouRFID_PRESENCE_heartbeat 0
+#endif
+
+/*! 
+ * \def ClouRFID_FILTER_bits 
+ * \brief Size of "already reported" Bloom filter in bits (0 - filter disabled)
+ * Must be power of 2 (8..32768), RAM usage ClouRFID_FILTER_bits/8 bytes
+ * Not used with presence tracking (ClouRFID_PRESENCE_len>0): presence events are reported once per arrival
+ */ 
+#ifndef ClouRFID_FILTER_bits
+  #define ClouRFID_FILTER_bits 0
+#endif
+
+/*! 
+ * \def ClouRFID_FILTER_k 
+ * \brief Qty of filter bits per tag (hash functions)
+ */ 
+#ifndef ClouRFID_FILTER_k
+  #define ClouRFID_FILTER_k 3
+#endif
+
+/*! 
+ * \def ClouRFID_FILTER_epoch 
+ * \brief Qty of scan cycles before filter clear (0 - clear by ClearFilter only)
+ */ 
+#ifndef ClouRFID_FILTER_epoch
+  #define ClouRFID_FILTER_epoch 0
+#endif
+
+/*! 
+ * \def ClouRFID_SPILL_batch 
+ * \brief Qty of records in SD card spill write buffer (0 - spill disabled)
+ * Tags not fitted in FIFO are saved to buffer, buffer is written to log file by whole blocks.
+ * Two buffers: one is filled while scan, full one is written by EndCycle
+ * RAM usage 2*ClouRFID_SPILL_batch*ClouRFID_SPILL_rec_len bytes (16*32 - one SD sector)
+ */ 
+#ifndef ClouRFID_SPILL_batch
+  #define ClouRFID_SPILL_batch 0
+#endif
+
+/*! 
+ * \def ClouRFID_SPILL_rec_len 
+ * \brief Size of log record in bytes (not less than ClouRFID_Tag_t size)
+ */ 
+#ifndef ClouRFID_SPILL_rec_len
+  #define ClouRFID_SPILL_rec_len 32
+#endif
+
+/*! 
+ * \def ClouRFID_SPILL_file 
+ * \brief Name of spill log file (8.3 for SD card)
+ */ 
+#ifndef ClouRFID_SPILL_file
+  #define ClouRFID_SPILL_file "RFIDLOG.BIN"
+#endif
 
 //! Error message if used wrong define values
 #if (ClouRFID_EPC_max_len==0)&&(ClouRFID_TID_max_len==0)
   #error "ClouRFID: Wrong read settings set EPC or/and TID length"
 #endif
+#if (ClouRFID_TAG_FIFO_len==0)||(ClouRFID_TAG_FIFO_len>254)
+  #error "ClouRFID: Wrong tag FIFO length"
+#endif
+#if (ClouRFID_FIFO_high>ClouRFID_TAG_FIFO_len)||((ClouRFID_FIFO_high>0)&&(ClouRFID_FIFO_low>=ClouRFID_FIFO_high))
+  #error "ClouRFID: Wrong FIFO water marks"
+#endif
+#if (ClouRFID_OP_timeout<10)||(ClouRFID_OP_timeout>2550)||(ClouRFID_OP_depth==0)
+  #error "ClouRFID: Wrong tag operation settings"
+#endif
+#if (ClouRFID_PRESENCE_miss==0)||(ClouRFID_PRESENCE_miss>250)
+  #error "ClouRFID: Wrong presence miss count"
+#endif
+#if (ClouRFID_SPILL_batch>255)||(ClouRFID_SPILL_rec_len==0)
+  #error "ClouRFID: Wrong spill settings"
+#endif
+#if (ClouRFID_FILTER_bits>32768)||((ClouRFID_FILTER_bits>0)&&(ClouRFID_FILTER_bits<8))||((ClouRFID_FILTER_bits&(ClouRFID_FILTER_bits-1))!=0)||(ClouRFID_FILTER_k==0)
+  #error "ClouRFID: Wrong filter settings"
+#endif
+#if (ClouRFID_FILTER_bits>0)&&(ClouRFID_PRESENCE_len>0)
+  #error "ClouRFID: Presence tracking and already reported filter are mutually exclusive"
+#endif
 
 /******************************************************************************
  * Includes
  ******************************************************************************/
 
 #include <inttypes.h>
+#if defined(__linux__)
+  #include <stdio.h>
+#endif
 
 /******************************************************************************
  * Type definitions
@@ -79,6 +237,26 @@ typedef struct{
   uint8_t  Data[ClouRFID_MaxDataLen];  /*< Message data   */
 } ClouRFID_Mes_t;
 
+/*! frame parse state */
+typedef struct{
+  uint8_t PackState;  /*< frame part */
+  uint16_t CRC;       /*< frame CRC */
+  uint16_t Temp;      /*< temporary var (CRC/Len) */
+} ClouRFID_Parser_t;
+
+/*! reader message type enum. */
+typedef enum {
+  ClouRFID_MT_RERR=0,   /*!< Reader error or warning message */ 
+  ClouRFID_MT_RCFG=1,   /*!< Reader configuration and management message */ 
+  ClouRFID_MT_RFID=2,   /*!< RFID configuration and operation message */ 
+  ClouRFID_MT_RLOG=3,   /*!< Reader log message */ 
+  ClouRFID_MT_RUPD=4,   /*!< Reader software upgrade message */ 
+  ClouRFID_MT_RTST=5    /*!< Testing message */ 
+}ClouRFID_MesType_t;
+
+/*! reader initiated message handler type */
+typedef void (*ClouRFID_Handler_t)(ClouRFID_Mes_t* Mess);
+
 /*! reader RFID ability type */
 typedef struct{
   uint8_t TxPowerMin;     /*< Min. transmission power */
@@ -98,6 +276,123 @@ typedef enum {
   ClouRFID_ERROR=0xFF   /*!< Fail */   
 }ClouRFID_RETURN_t;
 
+/*! inventory target (Gen2 inventoried flag) enum. */
+typedef enum {
+  ClouRFID_TARGET_A=0,  /*!< Inventory tags with flag A */ 
+  ClouRFID_TARGET_B=1,  /*!< Inventory tags with flag B */ 
+  ClouRFID_TARGET_AB=2  /*!< Inventory tags with flag A and B (toggle) */ 
+}ClouRFID_Target_t;
+
+/*! 
+ * \def ClouRFID_SESSION_DEFAULT 
+ * \brief SetInventory session value: use reader default inventory params
+ */ 
+#define ClouRFID_SESSION_DEFAULT 0xFF
+
+/*! 
+ * \def ClouRFID_Q_AUTO 
+ * \brief SetInventory Q value: select Q by tags qty of last round on antenna
+ */ 
+#define ClouRFID_Q_AUTO 0xFF
+
+/*! inventory params type */
+typedef struct{
+  uint8_t On;       /*!< 0 - reader default params */
+  uint8_t Session;  /*!< Gen2 session 0..3 */
+  uint8_t Target;   /*!< Target (\ref <ClouRFID_Target_t>) */
+  uint8_t Q;        /*!< Initial Q 0..15 or ClouRFID_Q_AUTO */
+} ClouRFID_Inventory_t;
+
+/*! tag operation enum. */
+typedef enum {
+  ClouRFID_OP_WRITE_EPC=0,  /*!< Write EPC memory bank */ 
+  ClouRFID_OP_WRITE_USER=1, /*!< Write user memory bank */ 
+  ClouRFID_OP_LOCK=2        /*!< Lock memory bank / password */ 
+}ClouRFID_OpType_t;
+
+/*! tag selection enum. */
+typedef enum {
+  ClouRFID_MATCH_NONE=0,    /*!< Any tag in antenna field */ 
+  ClouRFID_MATCH_EPC=1,     /*!< Tag with EPC starting with match data */ 
+  ClouRFID_MATCH_TID=2      /*!< Tag with TID starting with match data */ 
+}ClouRFID_Match_t;
+
+/*! lock area enum. */
+typedef enum {
+  ClouRFID_LOCK_KILL_PWD=0, /*!< Kill password */ 
+  ClouRFID_LOCK_ACCESS_PWD=1, /*!< Access password */ 
+  ClouRFID_LOCK_EPC=2,      /*!< EPC bank */ 
+  ClouRFID_LOCK_TID=3,      /*!< TID bank */ 
+  ClouRFID_LOCK_USER=4      /*!< User bank */ 
+}ClouRFID_LockArea_t;
+
+/*! lock type enum. */
+typedef enum {
+  ClouRFID_UNLOCK=0,        /*!< Unlock */ 
+  ClouRFID_LOCK=1,          /*!< Lock */ 
+  ClouRFID_LOCK_PERM_UNLOCK=2, /*!< Permanent unlock */ 
+  ClouRFID_LOCK_PERM_LOCK=3 /*!< Permanent lock */ 
+}ClouRFID_LockType_t;
+
+/*! 
+ * \def ClouRFID_OP_NO_RESP 
+ * \brief Tag operation result: no response from reader
+ */ 
+#define ClouRFID_OP_NO_RESP 0xFF
+
+/*! 
+ * \def ClouRFID_OP_PARAM 
+ * \brief Tag operation result: wrong params or command longer than ClouRFID_MaxDataLen
+ */ 
+#define ClouRFID_OP_PARAM 0xFE
+
+/*! tag memory operation type */
+typedef struct{
+  uint8_t Op;           /*!< Operation (\ref <ClouRFID_OpType_t>) */
+  uint8_t Ant;          /*!< Antenna ID (1..4) */
+  uint8_t MatchArea;    /*!< Tag selection (\ref <ClouRFID_Match_t>) */
+  uint8_t MatchLen;     /*!< Match data length (bytes) */
+  const uint8_t* Match; /*!< Match data (EPC or TID) */
+  uint32_t Password;    /*!< Access password, 0 - not used */
+  uint16_t Addr;        /*!< Write: start word address (EPC bank: 1 - PC, 2 - EPC) */
+  uint8_t Len;          /*!< Write: data length (bytes, even) */
+  const uint8_t* Data;  /*!< Write: data */
+  uint8_t LockArea;     /*!< Lock: area (\ref <ClouRFID_LockArea_t>) */
+  uint8_t LockType;     /*!< Lock: type (\ref <ClouRFID_LockType_t>) */
+  uint8_t Result;       /*!< Result: 0 - OK, reader error code, ClouRFID_OP_NO_RESP, ClouRFID_OP_PARAM */
+} ClouRFID_TagOp_t;
+
+/*! GS1 EPC header enum. */
+typedef enum {
+  ClouRFID_EPC_SGTIN96=0x30, /*!< Serialised global trade item number, 96 bit */
+  ClouRFID_EPC_SSCC96=0x31   /*!< Serial shipping container code, 96 bit */
+}ClouRFID_EPCType_t;
+
+/*! decoded GS1 EPC type */
+typedef struct{
+  uint8_t Header;        /*!< EPC header (\ref <ClouRFID_EPCType_t>) */
+  uint8_t Filter;        /*!< Filter value */
+  uint8_t Partition;     /*!< Partition value */
+  uint8_t CompanyDigits; /*!< Digits of company prefix */
+  uint64_t Company;      /*!< GS1 company prefix */
+  uint64_t Item;         /*!< SGTIN: indicator and item reference, SSCC: extension and serial reference */
+  uint64_t Serial;       /*!< SGTIN: serial number, SSCC: 0 */
+  uint64_t Key;          /*!< Manifest key: Header << 57 | company prefix and item reference digits */
+} ClouRFID_EPC_t;
+
+/*! manifest record type, table is sorted by Key */
+typedef struct{
+  uint64_t Key;          /*!< Manifest key (\ref <ClouRFID_EPC_t>) */
+  uint32_t Sku;          /*!< Product number */
+} ClouRFID_Sku_t;
+
+/*! tag presence event enum. */
+typedef enum {
+  ClouRFID_ARRIVED=0,   /*!< Tag read first time */ 
+  ClouRFID_DEPARTED=1,  /*!< Tag not read ClouRFID_PRESENCE_miss cycles */ 
+  ClouRFID_PRESENT=2    /*!< Heartbeat: tag still read */ 
+}ClouRFID_Event_t;
+
 typedef struct{
   #if ClouRFID_EPC_max_len>0
     uint8_t EPC[ClouRFID_EPC_max_len];  /*!< EPC code data */ 
@@ -113,8 +408,19 @@ typedef struct{
   
   uint8_t Ant;                        /*!< Antenna number */
   uint8_t RSSIdBm;                    /*!< RSSI level */
+
+  #if ClouRFID_PRESENCE_len>0
+    uint8_t Event;                    /*!< Presence event (\ref <ClouRFID_Event_t>) */
+  #endif
 } ClouRFID_Tag_t;
 
+/*! presence table cell type */
+typedef struct{
+  ClouRFID_Tag_t Tag;  /*!< Last read of tag */
+  uint8_t Miss;        /*!< 0 - free cell, 1 - read in this cycle, N - not read N-1 cycles */
+  uint8_t Age;         /*!< Cycles from last ARRIVED / PRESENT event */
+} ClouRFID_Presence_t;
+
 /******************************************************************************
  * Class
  ******************************************************************************/
@@ -126,6 +432,11 @@ class ClouRFID
 // Public functions. 
 //**********************************************************************
   public:
+   //! Driver state is cleared, port is closed
+    ClouRFID();
+   //! Mapped manifest file is unmapped, port is closed (Linux)
+    ~ClouRFID();
+
    /*!
     *  \def Start work with RS232/RS485 and USB (for debug)
     *  \param[in] Baudrate - speed of port (bits / sec)
@@ -135,6 +446,18 @@ class ClouRFID
     */
     ClouRFID_RETURN_t Start(uint32_t Baudrate,ClouRFID_Interface_t Intrface, uint8_t RS485addres);
 
+  #if defined(__linux__)
+   /*!
+    *  \def Start work with serial device (Linux)
+    *  \param[in] Device - tty device name (/dev/ttyUSB0), string must exist while reader is used
+    *  \param[in] Baudrate - speed of port (bits / sec)
+    *  \param[in] Intrface - RS485 /  RS232 (\ref <ClouRFID_Interface_t>)
+    *  \param[in] RS485addres - addres on RS485 bus 
+    *  \return ClouRFID_OK / ClouRFID_ERROR (\ref <ClouRFID_RETURN_t>)
+    */
+    ClouRFID_RETURN_t Start(const char* Device, uint32_t Baudrate,ClouRFID_Interface_t Intrface, uint8_t RS485addres);
+  #endif
+
    /*! 
     *  \def Scan tags and add to FIFO
     *  \param[in]  Antenna - Antena ID 
@@ -144,8 +467,42 @@ class ClouRFID
    //! Stop work with RS232/RS485 and USB (for debug)
     void Stop();
 
+   /*! 
+    *  \def End of scan cycle (call after ScanTags on all antennas)
+    *  Add DEPARTED and PRESENT events to FIFO if presence tracking is enabled
+    *  (not in cycle with inventory paused by FIFO high-water mark),
+    *  clear "already reported" filter at end of epoch,
+    *  write full spill buffers to log if FIFO is empty (SD card must be ON if spill is enabled)
+    */
+    void EndCycle();
+
+  #if ClouRFID_FEED_on>0
+   /*! 
+    *  \def Feed byte received from reader (interrupt safe producer, reader uploads tags itself)
+    *  Tag upload frames are added to FIFO, other frames are dropped. Don't use with ScanTags,
+    *  EndCycle and spill functions must be called with feeding interrupt disabled
+    *  \param[in] Data - received byte
+    */
+    void FeedByte(uint8_t Data);
+
+   /*! 
+    *  \def Start continuous read, reader uploads tags itself (RS232 only, call with feeding interrupt disabled)
+    *  \param[in] Ant - Antena ID
+    *  \return ClouRFID_OK / ClouRFID_ERROR (\ref <ClouRFID_RETURN_t>)
+    */
+    ClouRFID_RETURN_t FeedStart(uint8_t Ant);
+
+   /*! 
+    *  \def Flow control of continuous read (call in main loop with feeding interrupt disabled)
+    *  Stop read when FeedByte reached FIFO high-water mark, start it again when FIFO has not more
+    *  than ClouRFID_FIFO_low tags. Nothing is done if flow control is disabled
+    */
+    void FeedControl();
+  #endif
+
    /*! 
     *  \def Get tag from FIFO
+    *  GetTag and GetTagQty may be called from other context (thread / interrupt) than ScanTags and EndCycle
     *  \param[out] Out - pointer to reading ClouRFID_Tag_t
     *  \return ClouRFID_OK / ClouRFID_ERROR (\ref <ClouRFID_RETURN_t>)
     */
@@ -157,6 +514,134 @@ class ClouRFID
    //! Get quantity of antennas 
     uint8_t GetAntQty();
 
+   /*! 
+    *  \def Write tag memory or lock tag
+    *  \param[in,out] Op - operation, Result is updated (\ref <ClouRFID_TagOp_t>)
+    *  \return ClouRFID_OK / ClouRFID_ERROR (\ref <ClouRFID_RETURN_t>)
+    */
+    ClouRFID_RETURN_t TagOp(ClouRFID_TagOp_t* Op);
+
+   /*! 
+    *  \def Write tag memory or lock tags by list
+    *  Command for next tag is sent while result of previous one is outstanding (ClouRFID_OP_depth)
+    *  After response timeout all outstanding operations get ClouRFID_OP_NO_RESP (result unknown)
+    *  \param[in,out] Ops - operations list, Result is updated (\ref <ClouRFID_TagOp_t>)
+    *  \param[in] Qty - qty of operations
+    *  \return qty of successful operations
+    */
+    uint16_t TagOpBatch(ClouRFID_TagOp_t* Ops, uint16_t Qty);
+
+   //! Get successful tag operations per minute of last batch
+    uint32_t GetOpRate();
+
+   /*! 
+    *  \def Decode SGTIN-96 / SSCC-96 EPC of tag
+    *  \param[in] Tag - tag (\ref <ClouRFID_Tag_t>)
+    *  \param[out] Out - decoded EPC (\ref <ClouRFID_EPC_t>)
+    *  \return ClouRFID_OK / ClouRFID_ERROR - not SGTIN-96 / SSCC-96 (\ref <ClouRFID_RETURN_t>)
+    */
+    static ClouRFID_RETURN_t DecodeEPC(const ClouRFID_Tag_t* Tag, ClouRFID_EPC_t* Out);
+
+   /*! 
+    *  \def Set manifest table for SKU lookup
+    *  \param[in] Table - records sorted by Key, PROGMEM on AVR (first 64 kB of flash), 0 - no manifest
+    *  \param[in] Qty - qty of records
+    */
+    void SetManifest(const ClouRFID_Sku_t* Table, uint32_t Qty);
+
+  #if defined(__linux__)
+   /*! 
+    *  \def Map manifest file to memory (Linux)
+    *  \param[in] File - file of ClouRFID_Sku_t records (native layout) sorted by Key
+    *  \return ClouRFID_OK / ClouRFID_ERROR (\ref <ClouRFID_RETURN_t>)
+    */
+    ClouRFID_RETURN_t OpenManifest(const char* File);
+
+   /*! 
+    *  \def Get state of tty port (Linux)
+    *  Port is closed on I/O error (device unplugged), Start opens it again
+    *  \return ClouRFID_OK - port open / ClouRFID_ERROR - port closed (\ref <ClouRFID_RETURN_t>)
+    */
+    ClouRFID_RETURN_t GetPortState();
+  #endif
+
+   /*! 
+    *  \def Find manifest key (binary search)
+    *  \param[in] Key - manifest key (\ref <ClouRFID_EPC_t>)
+    *  \param[out] Sku - product number
+    *  \return ClouRFID_OK / ClouRFID_ERROR - not found (\ref <ClouRFID_RETURN_t>)
+    */
+    ClouRFID_RETURN_t FindSku(uint64_t Key, uint32_t* Sku);
+
+   /*! 
+    *  \def Decode EPC of tag and find it in manifest
+    *  \param[in] Tag - tag (\ref <ClouRFID_Tag_t>)
+    *  \param[out] Sku - product number
+    *  \return ClouRFID_OK / ClouRFID_ERROR - not GS1 EPC or not found (\ref <ClouRFID_RETURN_t>)
+    */
+    ClouRFID_RETURN_t GetSku(const ClouRFID_Tag_t* Tag, uint32_t* Sku);
+
+   //! Get quantity of tags lost (FIFO and spill buffer full) 
+    uint32_t GetLostQty();
+
+   //! Get total time of inventory pauses by FIFO high-water mark (ms) 
+    uint32_t GetPauseTime();
+
+   /*! 
+    *  \def Set inventory params of antenna (sent to reader before scan)
+    *  \param[in] Ant - antenna ID (1..4), 0 - all antennas
+    *  \param[in] Session - Gen2 session 0..3, ClouRFID_SESSION_DEFAULT - reader default params
+    *  (queried by Start, if reader doesn't report them last sent params stay)
+    *  \param[in] Target - inventoried flag target (\ref <ClouRFID_Target_t>)
+    *  \param[in] Q - initial Q 0..15 (reader adjusts Q dynamically), ClouRFID_Q_AUTO - by tags qty of last round
+    *  \return ClouRFID_OK / ClouRFID_ERROR - wrong params (\ref <ClouRFID_RETURN_t>)
+    */
+    ClouRFID_RETURN_t SetInventory(uint8_t Ant, uint8_t Session, ClouRFID_Target_t Target, uint8_t Q);
+
+   /*! 
+    *  \def Set handler of reader initiated messages (error, log ...)
+    *  Handler is called while driver waits for response or tag data
+    *  \param[in] Type - message type (\ref <ClouRFID_MesType_t>)
+    *  \param[in] Handler - handler function (0 - drop messages)
+    */
+    void SetHandler(ClouRFID_MesType_t Type, ClouRFID_Handler_t Handler);
+
+   /*! 
+    *  \def Clear "already reported" filter (start new epoch)
+    */
+    void ClearFilter();
+
+   /*! 
+    *  \def Get false positive rate estimate of "already reported" filter
+    *  \return probability (0..1) of new tag suppression
+    */
+    float GetFilterFPR();
+
+   /*! 
+    *  \def Move all tags from FIFO to spill log (SD card must be ON)
+    *  FIFO tags are written before spill buffers (read order), next tags are added to log till replay end.
+    *  Only whole blocks are written, rest of tags (FIFO ones too) stay in RAM buffer
+    *  \return ClouRFID_OK / ClouRFID_ERROR (\ref <ClouRFID_RETURN_t>)
+    */
+    ClouRFID_RETURN_t SpillTags();
+
+   /*! 
+    *  \def Move all tags from FIFO and RAM buffers to spill log file (block is padded by empty records)
+    *  \return ClouRFID_OK / ClouRFID_ERROR (\ref <ClouRFID_RETURN_t>)
+    */
+    ClouRFID_RETURN_t SpillFlush();
+
+   /*! 
+    *  \def Get next tag from spill log file (in write order)
+    *  Tags of RAM buffers are written at end of log, after log end new tags are added to FIFO again
+    *  \param[out] Out - pointer to reading ClouRFID_Tag_t
+    *  \return ClouRFID_OK / ClouRFID_ERROR - end of log (\ref <ClouRFID_RETURN_t>)
+    */
+    ClouRFID_RETURN_t ReplayTag(ClouRFID_Tag_t* Out);
+
+   //! Delete spill log file (after replay)
+    void SpillClear();
+
 //**********************************************************************
 // Private functions and variables
 //**********************************************************************
@@ -165,21 +650,92 @@ class ClouRFID
 
     uint8_t RS485addr; /*!< RS485 reader addres */
     uint8_t RS485on;   /*!< RS485 interface enable */
+
+    #if defined(__linux__)
+      const char* PortName;                    /*!< tty device name */
+      int PortFd;                              /*!< tty file descriptor (-1 - closed) */
+      uint8_t PortRxBuf[64];                   /*!< RX buffer */
+      uint8_t PortRxLen;                       /*!< bytes in RX buffer */
+      uint8_t PortRxPos;                       /*!< read index in RX buffer */
+      uint8_t PortTxBuf[ClouRFID_MaxDataLen+8]; /*!< TX frame buffer */
+      uint16_t PortTxLen;                      /*!< bytes in TX buffer */
+    #endif
     
-    //!RFID data FIFO
+    //!RFID data FIFO: single producer (ScanTags or FeedByte, EndCycle) / single consumer (GetTag, GetTagQty) lock-free ring
     ClouRFID_Tag_t tagFIFO[ClouRFID_TAG_FIFO_len+1];
-    //RFID data FIFO control values
-    uint16_t tagFIFO_in;   /*!< empty cell (ready for write) index */
-    uint16_t tagFIFO_out;  /*!< oldest full cell (ready for read) index */
-    uint16_t tagFIFO_count; /*!< number of full cells in FIFO */
+    //RFID data FIFO control values (8 bit - atomic on AVR), one cell is always empty
+    uint8_t tagFIFO_in;    /*!< first not published cell index, written by producer only */
+    uint8_t tagFIFO_out;   /*!< oldest full cell (ready for read) index, written by consumer only */
+    uint8_t tagFIFO_stage; /*!< empty cell (ready for write) index, cells from in are tags of round (not published) */
+    uint8_t tagRound;      /*!< ScanTags read command is active: tags are staged till round end */
+    uint32_t tagLost;      /*!< tags lost (FIFO full), written by producer only */
+
+    #if ClouRFID_FIFO_high>0
+      //Flow control
+      uint8_t tagPaused;       /*!< inventory paused by high-water mark */
+      uint8_t tagCycleSkip;    /*!< scan of cycle skipped or stopped by pause (no presence aging) */
+      uint32_t tagPauseStart;  /*!< pause start time (ms) */
+      uint32_t tagPauseTime;   /*!< total pause time (ms) */
+    #endif
+
+    #if ClouRFID_PRESENCE_len>0
+      //!Tags presence table
+      ClouRFID_Presence_t tagPresence[ClouRFID_PRESENCE_len];
+    #endif
+
+    #if ClouRFID_FILTER_bits>0
+      //!"Already reported" Bloom filter
+      uint8_t tagFilter[ClouRFID_FILTER_bits/8];
+      uint16_t tagFilter_set;   /*!< number of set bits in filter */
+      uint16_t tagFilter_cycle; /*!< scan cycles in current epoch */
+    #endif
+
+    #if ClouRFID_SPILL_batch>0
+      //!Spill log write buffers (one block each)
+      uint8_t spillBuf[2][ClouRFID_SPILL_batch*ClouRFID_SPILL_rec_len];
+      uint8_t spillCount[2]; /*!< number of records in write buffers */
+      uint8_t spillAct;      /*!< buffer being filled */
+      uint8_t spillOn;       /*!< new tags are added to log (log is not replayed) */
+      uint32_t spillRead;    /*!< replay offset in log file */
+      uint8_t spillMode;     /*!< log file is open: 0 - closed, 1 - read (replay), 2 - write (append) */
+      #if defined(__linux__)
+        FILE* spillFile;     /*!< open log file */
+      #endif
+    #endif
     
     ClouRFID_Mes_t cMess;      /*!< temporary frame (RX/TX) */
     ClouRFID_Params_t cParams; /*!< RFID reader params */
+
+    //!Inventory params
+    ClouRFID_Inventory_t cInventory[4]; /*!< params of antennas */
+    ClouRFID_Inventory_t cInvApplied;   /*!< params sent to reader */
+    ClouRFID_Inventory_t cInvDefault;   /*!< reader default params (On == 0 - unknown) */
+    uint16_t RoundTags[4];              /*!< tags qty of last round on antennas */
+    uint16_t RoundQty;                  /*!< tags read OK in current round */
+
+    uint32_t OpRate; /*!< tag operations per minute of last batch */
+
+    //!Manifest for SKU lookup
+    const ClouRFID_Sku_t* Manifest; /*!< records sorted by Key */
+    uint32_t ManifestQty;           /*!< qty of records */
+    #if defined(__linux__)
+      void* ManifestMap;            /*!< mapped manifest file (0 - not mapped) */
+      uint32_t ManifestSize;        /*!< mapped size (bytes) */
+    #endif
+
+    //!Reader initiated message handlers
+    ClouRFID_Handler_t Handlers[8];
+    uint8_t PendingType; /*!< message type of command waiting for response */
+    uint8_t PendingMID;  /*!< MID of command waiting for response */
     
     //!Parse frame state
-    uint8_t PackState; /*!< frame part  */
-    uint16_t CRC;      /*!< frame CRC  */
-    uint16_t Temp;     /*!< temporary var (CRC/Len) */
+    ClouRFID_Parser_t cParse; /*!< responses (GetResp) */
+    #if ClouRFID_FEED_on>0
+      ClouRFID_Parser_t feedParse; /*!< FeedByte */
+      ClouRFID_Mes_t feedMess;     /*!< frame received by FeedByte */
+      uint8_t feedAnt;             /*!< antenna of continuous read (FeedStart) */
+      uint8_t feedPause;           /*!< read stop requested by FeedByte (FIFO high-water mark) */
+    #endif
 
     /* Low lewel protocol and interface functions */
     
@@ -190,23 +746,198 @@ class ClouRFID
     void SendByte(uint8_t Data); 
     //! Send frame to reader 
     void SendPacket(ClouRFID_Mes_t* Mess);
+    //! Parse one received byte
+    uint8_t ParseByte(ClouRFID_Parser_t* Parser, ClouRFID_Mes_t* Mess, uint8_t Data);
     //! Receive frame from reader
     uint8_t GetPacket(ClouRFID_Mes_t* Mess);
     //! RS232/RS485 port enable
     uint8_t PortIni(uint32_t Speed);
     //! RS232/RS485 port disable
     void PortDeIni();
+    //! Switch port to transmission
+    void PortTX();
+    //! End of frame transmission
+    void PortSend();
+    //! Switch port to reception
+    void PortRX();
+    //! Read one received byte
+    uint8_t PortRead(uint8_t* Data);
+    //! Discard received data
+    void PortFlush();
+    #if defined(__linux__)
+      //! Close port on I/O error
+      void PortLost();
+    #endif
     
     /* High lewel protocol functions */
 
     //! Illegal command response detection
     uint8_t ErrorFilter(ClouRFID_Mes_t* Mess); 
+    //! Make write / lock command frame
+    uint8_t OpBuild(ClouRFID_TagOp_t* Op, ClouRFID_Mes_t* Mess);
+    //! Send inventory params of antenna to reader
+    void InventoryIni(uint8_t Ant);
+    //! Make EPC read command frame
+    void ReadCommand(uint8_t Ant, uint8_t Mode);
+    //! Route received frame to caller or handlers
+    uint8_t Dispatch(ClouRFID_Mes_t* Mess);
     //! Stop all RFID opperations 
     void StopRFID();
     //! Receive response from reader
-    uint8_t GetResp(ClouRFID_Mes_t* Mess);
+    uint8_t GetResp(ClouRFID_Mes_t* Mess, uint8_t Retry = 5);
     //! Parse EPC read response and update tag FIFO
     void AddTag(ClouRFID_Mes_t* Mess);
+    //! Compare EPC and/or TID of tags
+    uint8_t TagCmp(ClouRFID_Tag_t* A, ClouRFID_Tag_t* B);
+    //! Put tag to FIFO
+    uint8_t PushTag(ClouRFID_Tag_t* Tag);
+  #if ClouRFID_FEED_on>0
+    //! Feed bytes left in RX buffer by response wait
+    void FeedRest();
+  #endif
+    //! Publish staged tags of round to consumer
+    void PublishTags();
+    //! Quantity of tags in FIFO up to cell index
+    uint16_t FifoQty(uint8_t In);
+    //! Put tag to FIFO or spill log buffer
+    uint8_t QueueTag(ClouRFID_Tag_t* Tag);
+    //! Update presence table by read tag
+    uint8_t PresenceUpdate(ClouRFID_Tag_t* Tag);
+    //! Calculate filter hash of tag EPC and/or TID
+    uint32_t FilterHash(ClouRFID_Tag_t* Tag);
+    //! Test (and add) tag hash in "already reported" filter
+    uint8_t FilterCheck(uint32_t Hash, uint8_t Add);
+    //! Put tag to spill log write buffer
+    uint8_t SpillTag(ClouRFID_Tag_t* Tag);
+    //! Write FIFO tags and full spill buffers to log
+    uint8_t SpillSync(uint8_t Fifo);
+    //! Open spill log file for replay or append (kept open till mode change or close)
+    uint8_t SpillOpen(uint8_t Mode);
+    //! Close spill log file
+    uint8_t SpillClose();
+    //! Append data to open spill log file
+    uint8_t SpillWrite(uint8_t* Data, uint16_t Len);
+    //! Read next data from open spill log file
+    uint8_t SpillRead(uint8_t* Data, uint16_t Len);
+    //! Pointer to record of spill buffers (in read order)
+    uint8_t* SpillRec(uint16_t Index);
+};
+
+/******************************************************************************
+ * Linux gateway: many readers, one tag queue
+ ******************************************************************************/
+
+#if defined(__linux__)
+
+#include <pthread.h>
+
+/*! 
+ * \def ClouRFID_GW_readers 
+ * \brief Max qty of readers in gateway
+ */ 
+#ifndef ClouRFID_GW_readers
+  #define ClouRFID_GW_readers   32
+#endif
+
+/*! 
+ * \def ClouRFID_GW_QUEUE_len 
+ * \brief Qty of tags in gateway merged queue
+ */ 
+#ifndef ClouRFID_GW_QUEUE_len
+  #define ClouRFID_GW_QUEUE_len 1024
+#endif
+
+/*! gateway tag type */
+typedef struct{
+  ClouRFID_Tag_t Tag;   /*!< Tag data */
+  uint8_t Reader;       /*!< Reader number (order of AddReader, from 0) */
+} ClouRFID_GwTag_t;
+
+class ClouRFID_Gateway;
+
+/*! gateway reader state type */
+typedef struct{
+  ClouRFID* Reader;              /*!< Reader driver */
+  const char* Device;            /*!< tty device name */
+  uint32_t Baudrate;             /*!< speed of port (bits / sec) */
+  ClouRFID_Interface_t Intrface; /*!< RS485 /  RS232 */
+  uint8_t RS485addres;           /*!< addres on RS485 bus */
+  uint8_t Number;                /*!< Reader number */
+  pthread_t Thread;              /*!< Reader thread */
+  ClouRFID_Gateway* Gateway;     /*!< Owner */
+} ClouRFID_GwReader_t;
+
+class ClouRFID_Gateway
+{
+
+//**********************************************************************
+// Public functions. 
+//**********************************************************************
+  public:
+    ClouRFID_Gateway();
+    ~ClouRFID_Gateway();
+
+   /*!
+    *  \def Add reader to gateway (before Start)
+    *  \param[in] Device - tty device name, string must exist while gateway is used
+    *  \param[in] Baudrate - speed of port (bits / sec)
+    *  \param[in] Intrface - RS485 /  RS232 (\ref <ClouRFID_Interface_t>)
+    *  \param[in] RS485addres - addres on RS485 bus 
+    *  \return ClouRFID_OK / ClouRFID_ERROR (\ref <ClouRFID_RETURN_t>)
+    */
+    ClouRFID_RETURN_t AddReader(const char* Device, uint32_t Baudrate, ClouRFID_Interface_t Intrface, uint8_t RS485addres);
+
+   /*!
+    *  \def Start scan on all readers (one thread per reader)
+    *  \return ClouRFID_OK / ClouRFID_ERROR (\ref <ClouRFID_RETURN_t>)
+    */
+    ClouRFID_RETURN_t Start();
+
+   //! Stop scan on all readers
+    void Stop();
+
+   /*! 
+    *  \def Get tag from merged queue
+    *  \param[out] Out - pointer to reading ClouRFID_GwTag_t
+    *  \param[in] Timeout - max wait time (ms), 0 - no wait
+    *  \return ClouRFID_OK / ClouRFID_ERROR (\ref <ClouRFID_RETURN_t>)
+    */
+    ClouRFID_RETURN_t GetTag(ClouRFID_GwTag_t* Out, uint32_t Timeout);
+
+   //! Get quantity of tags in merged queue 
+    uint32_t GetTagQty();
+
+   //! Get quantity of tags lost (merged queue full) 
+    uint32_t GetLostQty();
+
+   //! Get quantity of scan cycles on all readers 
+    uint32_t GetCycleQty();
+
+//**********************************************************************
+// Private functions and variables
+//**********************************************************************
+
+  private:
+
+    ClouRFID_GwReader_t Readers[ClouRFID_GW_readers]; /*!< Readers state */
+    uint8_t ReaderQty;  /*!< Qty of readers */
+    uint8_t Run;        /*!< Reader threads run flag */
+    
+    //!Merged tag queue
+    ClouRFID_GwTag_t Queue[ClouRFID_GW_QUEUE_len];
+    uint32_t Queue_in;    /*!< empty cell (ready for write) index */
+    uint32_t Queue_count; /*!< number of full cells in queue */
+    uint32_t Lost;        /*!< tags lost */
+    uint32_t Cycles;      /*!< scan cycles */
+    pthread_mutex_t Lock; /*!< queue lock */
+    pthread_cond_t Ready; /*!< queue not empty */
+
+    //! Put tag to merged queue
+    void PushTag(ClouRFID_GwTag_t* Tag);
+    //! Reader thread
+    static void* ReaderThread(void* Arg);
 };
 
-#endif //ClouRFID_h
+#endif //defined(__linux__)
+
+#endif //ClouRFID_h
@@ -23,6 +23,7 @@ void loop()
   if(RFID.Start(115200,RS485,42)==ClouRFID_OK){                                         //Connection to reader success (start using RS485 and USB) 
       uint8_t Ant_Qty=RFID.GetAntQty();                                                 //Get antenna qty
       for(uint8_t ant=1;ant<=Ant_Qty;ant++) RFID.ScanTags(ant);                         //Scan tags on all antennas
+      RFID.EndCycle();                                                                  //End of scan cycle (presence events)
       RFID.Stop();                                                                      //Stop connection (stop using RS485 and USB) 
       if(RFID.GetTagQty()>0){                                                           //Process tags FIFO
         ClouRFID_Tag_t Display_Tag; 
@@ -46,6 +47,9 @@ void loop()
 
           USB.printf("\n\nEPC tag: %d",Tag_No++);                                       //Print Tag No
           USB.printf("\nANT: %d RSSI: %d dBm",Display_Tag.Ant, Display_Tag.RSSIdBm);    //Print ANT / RSSI
+          #if ClouRFID_PRESENCE_len>0
+            USB.printf("\nEVENT: %d",Display_Tag.Event);                                 //Print presence event
+          #endif
           
           uint8_t line,cnt;
 
@@ -0,0 +1,78 @@
+/*! \file bench_filter.cpp
+    \brief "Already reported" filter: measured false positive rate vs filter size (built for each
+    ClouRFID_FILTER_bits, see Makefile). Unique tags are read in chunks up to each fill level,
+    then new tags are tested against the filter without adding them: positives are false.
+ */
+
+#ifndef ClouRFID_FILTER_bits
+  #define ClouRFID_FILTER_bits 4096
+#endif
+#define ClouRFID_TAG_FIFO_len 254
+#include "fake_reader.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define private public //probe by FilterCheck without add
+#include "../ClouRFID.cpp"
+#undef private
+
+static ClouRFID RFID;
+static FakeReader* Reader;
+static uint32_t NextId = 1;
+
+//! Read Qty new unique tags, return qty of reported ones
+static uint32_t ReadNew(uint32_t Qty) {
+  uint32_t Reported = 0;
+  while (Qty > 0) {
+    uint32_t Chunk = (Qty > 200) ? 200 : Qty;
+    std::vector<FakeTag> Scene;
+    for (uint32_t i = 0; i < Chunk; i++) Scene.push_back(FakeReader::Tag(NextId++, 1, 50));
+    Reader->SetScene(Scene);
+    RFID.ScanTags(1);
+    ClouRFID_Tag_t Tag;
+    while (RFID.GetTag(&Tag) == ClouRFID_OK) Reported++;
+    Qty -= Chunk;
+  }
+  return Reported;
+}
+
+//! Test Qty never read tags (as read by ScanTags: EPC and TID), return qty of false positives
+static uint32_t Probe(uint32_t Qty) {
+  uint32_t Positive = 0;
+  for (uint32_t i = 0; i < Qty; i++) {
+    FakeTag F = FakeReader::Tag(0x80000000UL + i, 1, 50);
+    ClouRFID_Tag_t Tag;
+    memset(&Tag, 0, sizeof(Tag));
+    Tag.EPC_Len = 12;
+    memcpy(Tag.EPC, F.EPC, 12);
+    #if ClouRFID_TID_max_len > 0
+      Tag.TID_Len = 12;
+      memcpy(Tag.TID, F.EPC, 12);
+    #endif
+    if (RFID.FilterCheck(RFID.FilterHash(&Tag), 0) == 0) Positive++;
+  }
+  return Positive;
+}
+
+int main() {
+  static const uint32_t Fill[] = {100, 250, 500, 1000, 2000};
+  const uint32_t ProbeQty = 20000;
+  char Name[64];
+  snprintf(Name, sizeof(Name), "/tmp/clourfid_bfilter_%d", (int)getpid());
+  Reader = new FakeReader(Name);
+  CHECK(RFID.Start(Reader->Name, 115200, RS232, 0) == ClouRFID_OK);
+  RFID.ClearFilter();
+  uint32_t Read = 0, Reported = 0;
+  for (uint8_t i = 0; i < sizeof(Fill) / sizeof(Fill[0]); i++) {
+    Reported += ReadNew(Fill[i] - Read);
+    Read = Fill[i];
+    uint32_t Positive = Probe(ProbeQty);
+    printf("bench_filter: bits %5d (RAM %4d bytes) k %d, tags %4u (reported %4u): measured FPR %6.2f%%, estimate %6.2f%%\n",
+      ClouRFID_FILTER_bits, ClouRFID_FILTER_bits / 8, ClouRFID_FILTER_k, Read, Reported,
+      100.0 * Positive / ProbeQty, 100.0 * RFID.GetFilterFPR());
+  }
+  RFID.Stop();
+  delete Reader;
+  return 0;
+}
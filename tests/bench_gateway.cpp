@@ -0,0 +1,49 @@
+/*! \file bench_gateway.cpp
+    \brief Linux gateway scaling: 1..32 fake readers (50 tags each, FIFO of reader 64 tags), merged tags and scan cycles per second.
+ */
+
+#define ClouRFID_TAG_FIFO_len 64
+#include "fake_reader.h"
+#include "../ClouRFID.cpp"
+
+static const uint32_t TagsPerReader = 50;
+static const double RunMs = 2000;
+
+int main() {
+  static const uint8_t Qty[] = {1, 2, 4, 8, 16, 32};
+  FakeReader* Readers[32];
+  char Name[32][64];
+  for (uint8_t r = 0; r < 32; r++) {
+    snprintf(Name[r], sizeof(Name[r]), "/tmp/clourfid_bgw%d_%d", r, (int)getpid());
+    Readers[r] = new FakeReader(Name[r]);
+    std::vector<FakeTag> Scene;
+    for (uint32_t i = 0; i < TagsPerReader; i++) Scene.push_back(FakeReader::Tag(r * 1000 + i, 1, 50));
+    Readers[r]->SetScene(Scene);
+  }
+  for (uint8_t q = 0; q < sizeof(Qty) / sizeof(Qty[0]); q++) {
+    ClouRFID_Gateway* Gw = new ClouRFID_Gateway();
+    for (uint8_t r = 0; r < Qty[q]; r++) CHECK(Gw->AddReader(Name[r], 115200, RS232, 0) == ClouRFID_OK);
+    CHECK(Gw->Start() == ClouRFID_OK);
+    //Wait for first tag of all readers (connected), then measure
+    ClouRFID_GwTag_t Tag;
+    uint64_t Mask = 0;
+    double T0 = NowMs();
+    while ((Mask != (1ULL << Qty[q]) - 1) && (NowMs() - T0 < 10000)) {
+      if (Gw->GetTag(&Tag, 100) == ClouRFID_OK) Mask |= 1ULL << Tag.Reader;
+    }
+    uint32_t Cycles0 = Gw->GetCycleQty();
+    uint32_t Tags = 0;
+    T0 = NowMs();
+    while (NowMs() - T0 < RunMs) {
+      if (Gw->GetTag(&Tag, 100) == ClouRFID_OK) Tags++;
+    }
+    double Ms = NowMs() - T0;
+    uint32_t Cycles = Gw->GetCycleQty() - Cycles0;
+    printf("bench_gateway: readers %2d: %7.0f tags/s (%6.0f per reader), %6.1f cycles/s, lost %u\n",
+      Qty[q], Tags * 1000.0 / Ms, Tags * 1000.0 / Ms / Qty[q], Cycles * 1000.0 / Ms, Gw->GetLostQty());
+    Gw->Stop();
+    delete Gw;
+  }
+  for (uint8_t r = 0; r < 32; r++) delete Readers[r];
+  return 0;
+}
@@ -0,0 +1,67 @@
+/*! \file bench_manifest.cpp
+    \brief Manifest lookup: 100k SKU records in mapped file, GetSku (EPC decode + binary search) per second,
+    found and not found tags.
+ */
+
+#include "fake_reader.h"
+#include "../ClouRFID.cpp"
+
+static const uint32_t SkuQty = 100000;
+static const uint32_t LookupQty = 2000000;
+
+//! SGTIN-96 tag (partition 5: company 24 bits, item 20 bits) of company 614141
+static ClouRFID_Tag_t Sgtin(uint32_t Item, uint32_t Serial) {
+  ClouRFID_Tag_t T;
+  memset(&T, 0, sizeof(T));
+  uint64_t High = (3ULL << 53) | (5ULL << 50) | (614141ULL << 26) | ((uint64_t)Item << 6); //EPC bits 8..63
+  T.EPC[0] = ClouRFID_EPC_SGTIN96;
+  for (uint8_t i = 1; i < 8; i++) T.EPC[i] = (uint8_t)(High >> ((7 - i) * 8));
+  T.EPC[8] = Serial >> 24;
+  T.EPC[9] = Serial >> 16;
+  T.EPC[10] = Serial >> 8;
+  T.EPC[11] = Serial;
+  T.EPC_Len = 12;
+  return T;
+}
+
+int main() {
+  //Manifest of every 2nd item: odd items are not found
+  char File[64];
+  snprintf(File, sizeof(File), "/tmp/clourfid_bmanifest_%d.bin", (int)getpid());
+  std::vector<ClouRFID_Sku_t> Table(SkuQty);
+  for (uint32_t i = 0; i < SkuQty; i++) {
+    Table[i].Key = (0x30ULL << 57) | (614141000000ULL + i * 2);
+    Table[i].Sku = i;
+  }
+  FILE* F = fopen(File, "wb");
+  CHECK(F != NULL);
+  CHECK(fwrite(&Table[0], sizeof(ClouRFID_Sku_t), SkuQty, F) == SkuQty);
+  fclose(F);
+  ClouRFID* RFID = new ClouRFID();
+  CHECK(RFID->OpenManifest(File) == ClouRFID_OK);
+
+  //Tags of random items
+  std::vector<ClouRFID_Tag_t> Tags(4096);
+  std::vector<uint32_t> Items(4096);
+  srand(1);
+  for (uint32_t i = 0; i < Tags.size(); i++) {
+    Items[i] = rand() % (SkuQty * 2);
+    Tags[i] = Sgtin(Items[i], i);
+  }
+  uint32_t Found = 0;
+  uint32_t Sku;
+  double T0 = NowMs();
+  for (uint32_t i = 0; i < LookupQty; i++) {
+    if (RFID->GetSku(&Tags[i & 4095], &Sku) == ClouRFID_OK) {
+      CHECK(Sku * 2 == Items[i & 4095]);
+      Found++;
+    }
+  }
+  double Ms = NowMs() - T0;
+  CHECK((Found > LookupQty / 3) && (Found < LookupQty * 2 / 3));
+  printf("bench_manifest: %u records (%u kB mapped): %5.2f M lookups/s, %4.0f ns per lookup, found %u of %u\n",
+    SkuQty, (unsigned)(SkuQty * sizeof(ClouRFID_Sku_t) / 1024), LookupQty / Ms / 1000.0, Ms * 1e6 / LookupQty, Found, LookupQty);
+  delete RFID;
+  unlink(File);
+  return 0;
+}
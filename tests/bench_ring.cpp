@@ -0,0 +1,60 @@
+/*! \file bench_ring.cpp
+    \brief Tag FIFO ring throughput: FeedByte producer thread (parse, duplicate search, push) and
+    GetTag consumer thread (built for each ClouRFID_TAG_FIFO_len, see Makefile).
+ */
+
+#ifndef ClouRFID_TAG_FIFO_len
+  #define ClouRFID_TAG_FIFO_len 64
+#endif
+#define ClouRFID_FEED_on 1
+#include "fake_reader.h"
+#include "../ClouRFID.cpp"
+
+static const uint32_t TagQty = 1000000;
+static ClouRFID RFID;
+static uint8_t Stream[64 * 1024][64]; //prepared frames
+static uint16_t StreamLen[64 * 1024];
+static uint32_t Waits = 0;
+
+static void* Producer(void* Arg) {
+  for (uint32_t Id = 0; Id < TagQty; Id++) {
+    uint32_t i = Id % (64 * 1024);
+    if (i == 0) { //next serials of frames
+      for (uint32_t j = 0; j < 64 * 1024; j++) {
+        uint8_t D[64];
+        FakeTag T = FakeReader::Tag(Id + j, 1, 50);
+        StreamLen[j] = FakeReader::Frame(0x12, 0x00, D, FakeReader::Upload(T, true, D), Stream[j]);
+      }
+    }
+    if (RFID.GetTagQty() >= ClouRFID_TAG_FIFO_len) {
+      Waits++;
+      while (RFID.GetTagQty() >= ClouRFID_TAG_FIFO_len) sched_yield(); //FIFO full - wait for consumer
+    }
+    for (uint16_t j = 0; j < StreamLen[i]; j++) RFID.FeedByte(Stream[i][j]);
+  }
+  return NULL;
+}
+
+static void* Consumer(void* Arg) {
+  uint32_t Qty = 0;
+  ClouRFID_Tag_t Tag;
+  while (Qty < TagQty) {
+    if (RFID.GetTag(&Tag) == ClouRFID_OK) Qty++;
+    else sched_yield();
+  }
+  return NULL;
+}
+
+int main() {
+  pthread_t P, C;
+  double T0 = NowMs();
+  pthread_create(&C, NULL, Consumer, NULL);
+  pthread_create(&P, NULL, Producer, NULL);
+  pthread_join(P, NULL);
+  pthread_join(C, NULL);
+  double Ms = NowMs() - T0;
+  CHECK(RFID.GetLostQty() == 0);
+  printf("bench_ring: FIFO %3d tags, %u tags %4.0f ms: %5.2f Mtags/s, %6.1f MB/s of frames, producer waits %u\n",
+    ClouRFID_TAG_FIFO_len, TagQty, Ms, TagQty / Ms / 1000.0, TagQty * (double)StreamLen[0] / Ms / 1000.0, Waits);
+  return 0;
+}
@@ -0,0 +1,378 @@
+/*! \file fake_reader.h
+    \brief Fake Clou RFID reader on pseudo-terminal for host tests of ClouRFID driver.
+    Reader answers stop, query ability, baseband params config and query, EPC read (tags of scene,
+    single round or continuous till stop), tag write and lock (queued results with delay).
+    Flood mode sends log frames continuously, mute mode doesn't answer commands.
+    Device name is symlink to pty slave, so reader can be
+    unplugged (Unplug) and plugged again (Plug) under the same name.
+ */
+
+#ifndef fake_reader_h
+#define fake_reader_h
+
+#include <inttypes.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <termios.h>
+#include <pthread.h>
+#include <time.h>
+#include <vector>
+
+/*! result of tag write / lock command */
+struct FakeOp {
+  uint8_t Result;    /*!< result code (0 - OK) */
+  uint16_t DelayMs;  /*!< response delay */
+  uint8_t Answer;    /*!< 0 - no response */
+};
+
+/*! tag in antenna field */
+struct FakeTag {
+  uint8_t EPC[12];   /*!< EPC (SGTIN-96 or any) */
+  uint8_t Ant;       /*!< antenna 1..4 */
+  uint8_t RSSI;      /*!< RSSI */
+  uint8_t Result;    /*!< tag data read result (0 - OK) */
+};
+
+class FakeReader {
+  public:
+    char Name[64];              /*!< device name (symlink to pty slave) */
+    uint8_t AntQty;             /*!< antennas */
+    uint8_t ReaderQ, ReaderSession, ReaderFlag; /*!< applied baseband params */
+    uint8_t BasebandQuery;      /*!< answer baseband params query */
+    uint32_t ReadQty;           /*!< EPC read commands */
+    uint32_t ConfigQty;         /*!< baseband config commands */
+    uint32_t OpQty;             /*!< tag write / lock commands */
+    uint32_t OpSeen;            /*!< tag write / lock commands received before answer of first delayed one (0 - none yet) */
+    uint8_t Flood;              /*!< send reader log frames continuously */
+    uint8_t Mute;               /*!< don't answer commands */
+    uint8_t Reading;            /*!< antennas of continuous read (0 - idle) */
+    std::vector<FakeTag> Scene; /*!< tags in field (under Mx) */
+    std::vector<FakeOp> Ops;    /*!< results of next tag write / lock commands (under Mx), OK if empty */
+    pthread_mutex_t Mx;
+
+    FakeReader(const char* Device) {
+      snprintf(Name, sizeof(Name), "%s", Device);
+      AntQty = 1;
+      ReaderQ = 4;
+      ReaderSession = 0;
+      ReaderFlag = 0;
+      BasebandQuery = 1;
+      ReadQty = ConfigQty = OpQty = OpSeen = 0;
+      Flood = Mute = Reading = 0;
+      Tid = false;
+      Master = -1;
+      Slave = -1;
+      Run = 0;
+      pthread_mutex_init(&Mx, NULL);
+      Plug();
+    }
+
+    ~FakeReader() {
+      Unplug();
+      unlink(Name);
+      pthread_mutex_destroy(&Mx);
+    }
+
+    //! Create pty and start reader thread
+    void Plug() {
+      char Pts[64];
+      if (openpty(&Master, &Slave, Pts, NULL, NULL) != 0) { perror("openpty"); exit(1); }
+      struct termios Tio;
+      tcgetattr(Slave, &Tio);
+      cfmakeraw(&Tio);
+      tcsetattr(Slave, TCSANOW, &Tio);
+      fcntl(Master, F_SETFL, O_NONBLOCK);
+      unlink(Name);
+      if (symlink(Pts, Name) != 0) { perror("symlink"); exit(1); }
+      __atomic_store_n(&Run, 1, __ATOMIC_RELEASE);
+      pthread_create(&Thread, NULL, Loop, this);
+    }
+
+    //! Stop reader thread and close pty (driver gets I/O error)
+    void Unplug() {
+      if (Master < 0) return;
+      __atomic_store_n(&Run, 0, __ATOMIC_RELEASE);
+      pthread_join(Thread, NULL);
+      close(Master);
+      close(Slave);
+      Master = Slave = -1;
+    }
+
+    //! Set tags in field
+    void SetScene(const std::vector<FakeTag>& Tags) {
+      pthread_mutex_lock(&Mx);
+      Scene = Tags;
+      pthread_mutex_unlock(&Mx);
+    }
+
+    //! Queue result of next tag write / lock command
+    void AddOp(uint8_t Result, uint16_t DelayMs, uint8_t Answer = 1) {
+      FakeOp Op = {Result, DelayMs, Answer};
+      pthread_mutex_lock(&Mx);
+      Ops.push_back(Op);
+      pthread_mutex_unlock(&Mx);
+    }
+
+    //! Make test tag: EPC is SGTIN-96 like with serial number Id
+    static FakeTag Tag(uint32_t Id, uint8_t Ant, uint8_t RSSI) {
+      FakeTag T;
+      static const uint8_t Head[8] = {0x30, 0x74, 0x25, 0x7B, 0xF7, 0x19, 0x4E, 0x40};
+      memcpy(T.EPC, Head, 8);
+      T.EPC[8] = Id >> 24;
+      T.EPC[9] = Id >> 16;
+      T.EPC[10] = Id >> 8;
+      T.EPC[11] = Id;
+      T.Ant = Ant;
+      T.RSSI = RSSI;
+      T.Result = 0;
+      return T;
+    }
+
+    //! Serial number of test tag EPC
+    static uint32_t TagId(const uint8_t* EPC) {
+      return ((uint32_t)EPC[8] << 24) | ((uint32_t)EPC[9] << 16) | ((uint32_t)EPC[10] << 8) | EPC[11];
+    }
+
+    //! Make frame (Out min Len + 7 bytes), return frame length
+    static uint16_t Frame(uint8_t Control, uint8_t MID, const uint8_t* Data, uint16_t Len, uint8_t* Out) {
+      Out[0] = 0xAA;
+      Out[1] = Control;
+      Out[2] = MID;
+      Out[3] = Len >> 8;
+      Out[4] = Len & 0xFF;
+      memcpy(&Out[5], Data, Len);
+      uint16_t C = Crc(&Out[1], Len + 4);
+      Out[5 + Len] = C >> 8;
+      Out[6 + Len] = C & 0xFF;
+      return Len + 7;
+    }
+
+    //! Make tag upload data (Out min 48 bytes), TID (same as EPC) if Tid, return data length
+    static uint16_t Upload(const FakeTag& T, bool Tid, uint8_t* Out) {
+      uint16_t N = 0;
+      Out[N++] = 0;
+      Out[N++] = 12;
+      memcpy(&Out[N], T.EPC, 12);
+      N += 12;
+      Out[N++] = 0x30; //PC
+      Out[N++] = 0x00;
+      Out[N++] = T.Ant;
+      Out[N++] = 1; //PID 1: RSSI
+      Out[N++] = T.RSSI;
+      Out[N++] = 2; //PID 2: read result
+      Out[N++] = T.Result;
+      if (Tid) {
+        Out[N++] = 3; //PID 3: TID
+        Out[N++] = 0;
+        Out[N++] = 12;
+        memcpy(&Out[N], T.EPC, 12);
+        N += 12;
+      }
+      return N;
+    }
+
+  private:
+    int Master, Slave;
+    uint8_t Run;
+    pthread_t Thread;
+    uint8_t Rx[512];
+    uint16_t RxLen;
+    bool Tid;
+
+    //! Upload tags of scene on antennas (mask)
+    void Round(uint8_t Ants) {
+      uint8_t R[64];
+      pthread_mutex_lock(&Mx);
+      std::vector<FakeTag> Tags = Scene;
+      pthread_mutex_unlock(&Mx);
+      for (size_t i = 0; i < Tags.size(); i++) {
+        if ((Ants & (1 << (Tags[i].Ant - 1))) == 0) continue;
+        Send(0x12, 0x00, R, Upload(Tags[i], Tid, R));
+      }
+    }
+
+    static uint16_t Crc(const uint8_t* Data, uint16_t Len) {
+      uint16_t C = 0;
+      for (uint16_t i = 0; i < Len; i++) {
+        uint8_t B = Data[i];
+        for (uint8_t j = 0; j < 8; j++) {
+          if (((C & 0x8000) >> 8) ^ (B & 0x80)) C = (C << 1) ^ 0x8005;
+          else C = C << 1;
+          B <<= 1;
+        }
+      }
+      return C;
+    }
+
+    void Send(uint8_t Control, uint8_t MID, const uint8_t* Data, uint16_t Len) {
+      uint8_t F[300];
+      if (Len > sizeof(F) - 7) return;
+      uint16_t FLen = Frame(Control, MID, Data, Len, F);
+      uint16_t Pos = 0;
+      while (Pos < FLen) {
+        ssize_t Wr = write(Master, &F[Pos], FLen - Pos);
+        if (Wr > 0) Pos += Wr;
+        else if (!__atomic_load_n(&Run, __ATOMIC_ACQUIRE)) return;
+        else usleep(100);
+      }
+    }
+
+    void Handle(uint8_t Control, uint8_t MID, const uint8_t* Data, uint16_t Len) {
+      uint8_t R[64];
+      if (__atomic_load_n(&Mute, __ATOMIC_ACQUIRE)) return;
+      if ((Control & 0x07) != 2) return; //RFID commands only
+      switch (MID) {
+      case 0xFF: //stop
+        __atomic_store_n(&Reading, 0, __ATOMIC_RELEASE);
+        R[0] = 0;
+        Send(0x02, 0xFF, R, 1);
+        break;
+      case 0x00: //query RFID ability
+        R[0] = 0;
+        R[1] = 33;
+        R[2] = AntQty;
+        Send(0x02, 0x00, R, 3);
+        break;
+      case 0x0B: //config baseband params
+        ConfigQty++;
+        for (uint16_t i = 0; i + 1 < Len; i += 2) {
+          if (Data[i] == 2) ReaderQ = Data[i + 1];
+          if (Data[i] == 3) ReaderSession = Data[i + 1];
+          if (Data[i] == 4) ReaderFlag = Data[i + 1];
+        }
+        R[0] = 0;
+        Send(0x02, 0x0B, R, 1);
+        break;
+      case 0x0C: //query baseband params: speed, Q, session, flag
+        if (!BasebandQuery) break;
+        R[0] = 0;
+        R[1] = ReaderQ;
+        R[2] = ReaderSession;
+        R[3] = ReaderFlag;
+        Send(0x02, 0x0C, R, 4);
+        break;
+      case 0x10: { //read EPC: response, tag uploads, read finish
+        ReadQty++;
+        R[0] = 0;
+        Send(0x02, 0x10, R, 1);
+        if (Len == 0) break;
+        Tid = Len > 2; //PID 2 of command: TID read
+        if ((Len > 1) && (Data[1] == 1)) { //continuous: uploads by reader thread till stop
+          __atomic_store_n(&Reading, Data[0], __ATOMIC_RELEASE);
+          break;
+        }
+        Round(Data[0]);
+        R[0] = 0;
+        Send(0x12, 0x01, R, 1);
+        break;
+      }
+      case 0x11: //write tag
+      case 0x12: { //lock tag
+        OpQty++;
+        FakeOp Op = {0, 0, 1};
+        pthread_mutex_lock(&Mx);
+        if (!Ops.empty()) {
+          Op = Ops.front();
+          Ops.erase(Ops.begin());
+        }
+        pthread_mutex_unlock(&Mx);
+        if (Op.DelayMs) {
+          usleep(Op.DelayMs * 1000);
+          ssize_t Rd = read(Master, Rx + RxLen, sizeof(Rx) - RxLen); //commands sent meanwhile (not handled yet)
+          if (Rd > 0) RxLen += Rd;
+          if (OpSeen == 0) OpSeen = OpQty + QueuedOps((uint16_t)(Data - Rx) + Len + 2);
+        }
+        if (!Op.Answer) break;
+        R[0] = Op.Result;
+        Send(0x02, MID, R, 1);
+        break;
+      }
+      default:
+        break;
+      }
+    }
+
+    //! Tag write / lock commands in RX buffer from Pos
+    uint32_t QueuedOps(uint16_t Pos) {
+      uint32_t Qty = 0;
+      while (Pos + 5 <= RxLen) {
+        if (Rx[Pos] != 0xAA) {
+          Pos++;
+          continue;
+        }
+        uint8_t Addr = (Rx[Pos + 1] & 0x20) ? 1 : 0;
+        if (Pos + 5 + Addr > RxLen) break;
+        uint16_t Full = 5 + Addr + (((uint16_t)Rx[Pos + 3 + Addr] << 8) | Rx[Pos + 4 + Addr]) + 2;
+        if (Pos + Full > RxLen) break;
+        uint8_t MID = Rx[Pos + 2 + Addr];
+        if (((Rx[Pos + 1] & 0x07) == 2) && ((MID == 0x11) || (MID == 0x12))) Qty++;
+        Pos += Full;
+      }
+      return Qty;
+    }
+
+    void Parse() {
+      while (RxLen > 0) {
+        if (Rx[0] != 0xAA) { //find frame head
+          memmove(Rx, Rx + 1, --RxLen);
+          continue;
+        }
+        if (RxLen < 5) return;
+        uint8_t Addr = (Rx[1] & 0x20) ? 1 : 0; //RS485 address
+        if (RxLen < 5 + Addr) return;
+        uint16_t Len = ((uint16_t)Rx[3 + Addr] << 8) | Rx[4 + Addr];
+        uint16_t Full = 5 + Addr + Len + 2;
+        if (Len > 200) { //not a frame
+          memmove(Rx, Rx + 1, --RxLen);
+          continue;
+        }
+        if (RxLen < Full) return;
+        uint16_t C = Crc(&Rx[1], Full - 3);
+        if (C == (((uint16_t)Rx[Full - 2] << 8) | Rx[Full - 1])) {
+          Handle(Rx[1], Rx[2], &Rx[5 + Addr], Len);
+        }
+        RxLen -= Full;
+        memmove(Rx, Rx + Full, RxLen);
+      }
+    }
+
+    static void* Loop(void* Arg) {
+      FakeReader* F = (FakeReader*)Arg;
+      F->RxLen = 0;
+      while (__atomic_load_n(&F->Run, __ATOMIC_ACQUIRE)) {
+        uint8_t Flood = __atomic_load_n(&F->Flood, __ATOMIC_ACQUIRE);
+        struct pollfd P = {F->Master, (short)(Flood ? (POLLIN | POLLOUT) : POLLIN), 0};
+        poll(&P, 1, 10);
+        if (Flood && (P.revents & POLLOUT)) { //log message (reader initiated)
+          static const char Log[] = "fake reader log";
+          F->Send(0x13, 0x00, (const uint8_t*)Log, sizeof(Log) - 1);
+        }
+        ssize_t Rd = read(F->Master, F->Rx + F->RxLen, sizeof(F->Rx) - F->RxLen);
+        if (Rd > 0) {
+          F->RxLen += Rd;
+          F->Parse();
+        }
+        uint8_t Ants = __atomic_load_n(&F->Reading, __ATOMIC_ACQUIRE);
+        if (Ants && (Rd <= 0)) F->Round(Ants); //continuous read: next round when no command
+
+      }
+      return NULL;
+    }
+};
+
+//! Time (ms)
+static inline double NowMs() {
+  struct timespec T;
+  clock_gettime(CLOCK_MONOTONIC, &T);
+  return T.tv_sec * 1000.0 + T.tv_nsec / 1e6;
+}
+
+//! Test check with message
+#define CHECK(x) do { if (!(x)) { fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #x); exit(1); } } while (0)
+
+#endif //fake_reader_h
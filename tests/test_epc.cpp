@@ -0,0 +1,96 @@
+/*! \file test_epc.cpp
+    \brief GS1 EPC decoding (SGTIN-96, SSCC-96 reference vectors), manifest lookup by table and mapped file,
+    manifest file unmapped when driver is deleted.
+ */
+
+#include "fake_reader.h"
+#include "../ClouRFID.cpp"
+
+//! Make tag from EPC hex string
+static ClouRFID_Tag_t Tag(const char* Hex) {
+  ClouRFID_Tag_t T;
+  memset(&T, 0, sizeof(T));
+  for (uint8_t i = 0; i < 12; i++) {
+    unsigned int B;
+    sscanf(&Hex[i * 2], "%2x", &B);
+    T.EPC[i] = B;
+  }
+  T.EPC_Len = 12;
+  return T;
+}
+
+//! Check if file is mapped to process memory
+static bool Mapped(const char* File) {
+  char Line[512];
+  bool Ret = false;
+  FILE* F = fopen("/proc/self/maps", "r");
+  if (F == NULL) return false;
+  while (fgets(Line, sizeof(Line), F) != NULL) {
+    if (strstr(Line, File) != NULL) Ret = true;
+  }
+  fclose(F);
+  return Ret;
+}
+
+int main() {
+  ClouRFID_EPC_t E;
+
+  //SGTIN-96 urn:epc:tag:sgtin-96:3.0614141.812345.6789
+  ClouRFID_Tag_t Sgtin = Tag("3074257BF7194E4000001A85");
+  CHECK(ClouRFID::DecodeEPC(&Sgtin, &E) == ClouRFID_OK);
+  CHECK(E.Header == ClouRFID_EPC_SGTIN96);
+  CHECK(E.Filter == 3 && E.Partition == 5 && E.CompanyDigits == 7);
+  CHECK(E.Company == 614141 && E.Item == 812345 && E.Serial == 6789);
+  CHECK(E.Key == ((0x30ULL << 57) | 614141812345ULL));
+
+  //SSCC-96 urn:epc:tag:sscc-96:3.0614141.1234567890
+  ClouRFID_Tag_t Sscc = Tag("3174257BF4499602D2000000");
+  CHECK(ClouRFID::DecodeEPC(&Sscc, &E) == ClouRFID_OK);
+  CHECK(E.Header == ClouRFID_EPC_SSCC96);
+  CHECK(E.Filter == 3 && E.Partition == 5 && E.CompanyDigits == 7);
+  CHECK(E.Company == 614141 && E.Item == 1234567890 && E.Serial == 0);
+  CHECK(E.Key == ((0x31ULL << 57) | 6141411234567890ULL));
+
+  //Not GS1 EPC: header, partition 7, short EPC, item reference out of range
+  ClouRFID_Tag_t Bad = Tag("E2801105000000000000001A");
+  CHECK(ClouRFID::DecodeEPC(&Bad, &E) == ClouRFID_ERROR);
+  Bad = Tag("307C257BF7194E4000001A85");
+  CHECK(ClouRFID::DecodeEPC(&Bad, &E) == ClouRFID_ERROR);
+  Bad = Sgtin;
+  Bad.EPC_Len = 8;
+  CHECK(ClouRFID::DecodeEPC(&Bad, &E) == ClouRFID_ERROR);
+  Bad = Tag("30742FFFFFFFFFC000001A85");
+  CHECK(ClouRFID::DecodeEPC(&Bad, &E) == ClouRFID_ERROR);
+
+  //Manifest table
+  static const ClouRFID_Sku_t Table[] = {
+    {(0x30ULL << 57) | 614141812344ULL, 1000},
+    {(0x30ULL << 57) | 614141812345ULL, 1001},
+    {(0x31ULL << 57) | 6141411234567890ULL, 2001},
+  };
+  ClouRFID* RFID = new ClouRFID();
+  uint32_t Sku = 0;
+  CHECK(RFID->GetSku(&Sgtin, &Sku) == ClouRFID_ERROR); //no manifest
+  RFID->SetManifest(Table, 3);
+  CHECK(RFID->GetSku(&Sgtin, &Sku) == ClouRFID_OK && Sku == 1001);
+  CHECK(RFID->GetSku(&Sscc, &Sku) == ClouRFID_OK && Sku == 2001);
+  ClouRFID_Tag_t Other = Tag("3074257BF7194E8000001A85"); //item 812346
+  CHECK(RFID->GetSku(&Other, &Sku) == ClouRFID_ERROR);
+
+  //Manifest file, unmapped on delete
+  char File[64];
+  snprintf(File, sizeof(File), "/tmp/clourfid_manifest_%d.bin", (int)getpid());
+  FILE* F = fopen(File, "wb");
+  CHECK(F != NULL);
+  CHECK(fwrite(Table, sizeof(Table), 1, F) == 1);
+  fclose(F);
+  CHECK(RFID->OpenManifest(File) == ClouRFID_OK);
+  CHECK(Mapped(File));
+  CHECK(RFID->GetSku(&Sscc, &Sku) == ClouRFID_OK && Sku == 2001);
+  delete RFID;
+  CHECK(!Mapped(File));
+  unlink(File);
+
+  printf("test_epc: OK\n");
+  return 0;
+}
@@ -0,0 +1,56 @@
+/*! \file test_flood.cpp
+    \brief Reader flooding log frames: responses and tags still received, commands without
+    response time out.
+ */
+
+#include "fake_reader.h"
+#include "../ClouRFID.cpp"
+
+static ClouRFID RFID;
+static uint32_t LogQty = 0;
+static useconds_t LogWork = 0;
+
+//! Log handler, with some work (e.g. SD write) reader refills port buffer meanwhile
+static void OnLog(ClouRFID_Mes_t* Mess) {
+  LogQty++;
+  if (LogWork > 0) usleep(LogWork);
+}
+
+int main() {
+  char Name[64];
+  snprintf(Name, sizeof(Name), "/tmp/clourfid_flood_%d", (int)getpid());
+  FakeReader Reader(Name);
+  CHECK(RFID.Start(Reader.Name, 115200, RS232, 0) == ClouRFID_OK);
+  RFID.SetHandler(ClouRFID_MT_RLOG, OnLog);
+  Reader.SetScene({FakeReader::Tag(1, 1, 50), FakeReader::Tag(2, 1, 60)});
+
+  //Log frames between responses and tag uploads
+  __atomic_store_n(&Reader.Flood, 1, __ATOMIC_RELEASE);
+  RFID.ScanTags(1);
+  CHECK(RFID.GetTagQty() == 2);
+  CHECK(LogQty > 0);
+  ClouRFID_Tag_t Tag;
+  while (RFID.GetTag(&Tag) == ClouRFID_OK) {}
+
+  //No response: flood must not keep driver waiting
+  __atomic_store_n(&Reader.Mute, 1, __ATOMIC_RELEASE);
+  LogWork = 200;
+  uint32_t Before = LogQty;
+  double T0 = NowMs();
+  RFID.ScanTags(1);
+  double Elapsed = NowMs() - T0;
+  CHECK(LogQty > Before);
+  CHECK(RFID.GetTagQty() == 0);
+  CHECK(Elapsed < 5000);
+
+  //Reader answers again
+  __atomic_store_n(&Reader.Flood, 0, __ATOMIC_RELEASE);
+  __atomic_store_n(&Reader.Mute, 0, __ATOMIC_RELEASE);
+  LogWork = 0;
+  RFID.ScanTags(1);
+  CHECK(RFID.GetTagQty() == 2);
+
+  RFID.Stop();
+  printf("test_flood: OK (muted scan %.0f ms, %u log frames)\n", Elapsed, LogQty);
+  return 0;
+}
@@ -0,0 +1,75 @@
+/*! \file test_gateway.cpp
+    \brief Linux gateway with fake readers: tags of all readers are merged, reader unplugged and
+    plugged again is reconnected, port on file descriptor 0 works.
+ */
+
+#include "fake_reader.h"
+#include "../ClouRFID.cpp"
+#include <set>
+
+static const uint8_t ReaderQty = 3;
+
+//! Wait for tags of reader (Ids First..First+Qty-1), other tags are skipped
+static bool WaitTags(ClouRFID_Gateway* Gw, uint8_t Reader, uint32_t First, uint32_t Qty, double TimeoutMs) {
+  std::set<uint32_t> Seen;
+  double T0 = NowMs();
+  ClouRFID_GwTag_t Tag;
+  while ((Seen.size() < Qty) && (NowMs() - T0 < TimeoutMs)) {
+    if (Gw->GetTag(&Tag, 100) != ClouRFID_OK) continue;
+    uint32_t Id = FakeReader::TagId(Tag.Tag.EPC);
+    if ((Tag.Reader == Reader) && (Id >= First) && (Id < First + Qty)) Seen.insert(Id);
+  }
+  return Seen.size() == Qty;
+}
+
+int main() {
+  FakeReader* Readers[ReaderQty];
+  char Name[ReaderQty][64];
+  for (uint8_t r = 0; r < ReaderQty; r++) {
+    snprintf(Name[r], sizeof(Name[r]), "/tmp/clourfid_gw%d_%d", r, (int)getpid());
+    Readers[r] = new FakeReader(Name[r]);
+    Readers[r]->AntQty = 1 + r % 2;
+    std::vector<FakeTag> Scene;
+    for (uint32_t i = 0; i < 5; i++) Scene.push_back(FakeReader::Tag(r * 1000 + i, 1 + i % Readers[r]->AntQty, 50));
+    Readers[r]->SetScene(Scene);
+  }
+
+  //Port may get descriptor 0
+  close(0);
+  ClouRFID* Single = new ClouRFID();
+  CHECK(Single->GetPortState() == ClouRFID_ERROR);
+  CHECK(Single->Start(Name[0], 115200, RS232, 0) == ClouRFID_OK);
+  CHECK(Single->GetPortState() == ClouRFID_OK);
+  Single->Stop();
+  CHECK(Single->GetPortState() == ClouRFID_ERROR);
+  delete Single;
+
+  ClouRFID_Gateway* Gw = new ClouRFID_Gateway();
+  for (uint8_t r = 0; r < ReaderQty; r++) CHECK(Gw->AddReader(Name[r], 115200, RS232, 0) == ClouRFID_OK);
+  CHECK(Gw->Start() == ClouRFID_OK);
+  for (uint8_t r = 0; r < ReaderQty; r++) CHECK(WaitTags(Gw, r, r * 1000, 5, 5000));
+
+  //Unplug reader 1, tags of other readers are still read
+  Readers[1]->Unplug();
+  CHECK(WaitTags(Gw, 0, 0, 5, 3000));
+  //Plug with other tags: reader is reconnected
+  std::vector<FakeTag> Scene;
+  for (uint32_t i = 0; i < 5; i++) Scene.push_back(FakeReader::Tag(1500 + i, 1, 50));
+  Readers[1]->SetScene(Scene);
+  Readers[1]->Plug();
+  CHECK(WaitTags(Gw, 1, 1500, 5, 5000));
+  CHECK(Gw->GetCycleQty() > 0);
+
+  Gw->Stop();
+  //Empty queue: timed wait (monotonic clock) lasts the timeout
+  ClouRFID_GwTag_t Tag;
+  while (Gw->GetTag(&Tag, 0) == ClouRFID_OK);
+  double T0 = NowMs();
+  CHECK(Gw->GetTag(&Tag, 200) == ClouRFID_ERROR);
+  double Wait = NowMs() - T0;
+  CHECK((Wait >= 190) && (Wait < 1000));
+  delete Gw;
+  for (uint8_t r = 0; r < ReaderQty; r++) delete Readers[r];
+  printf("test_gateway: OK\n");
+  return 0;
+}
@@ -0,0 +1,95 @@
+/*! \file test_inventory.cpp
+    \brief Inventory params of antennas: custom params sent when changed, reader default params
+    (queried by Start) sent back for ClouRFID_SESSION_DEFAULT antennas, ClouRFID_Q_AUTO sized by tags
+    read OK in last round.
+ */
+
+#include "fake_reader.h"
+#include "../ClouRFID.cpp"
+
+static void CheckParams(FakeReader* Reader, uint8_t Q, uint8_t Session, uint8_t Flag) {
+  CHECK(Reader->ReaderQ == Q);
+  CHECK(Reader->ReaderSession == Session);
+  CHECK(Reader->ReaderFlag == Flag);
+}
+
+int main() {
+  char Name[64];
+  snprintf(Name, sizeof(Name), "/tmp/clourfid_inv_%d", (int)getpid());
+  FakeReader Reader(Name);
+  Reader.AntQty = 2;
+  Reader.ReaderQ = 5; //reader defaults
+  Reader.ReaderSession = 1;
+  Reader.ReaderFlag = 2;
+  ClouRFID* RFID = new ClouRFID();
+  CHECK(RFID->Start(Reader.Name, 115200, RS232, 0) == ClouRFID_OK);
+
+  //Antenna 1 custom, antenna 2 reader default
+  CHECK(RFID->SetInventory(1, 2, ClouRFID_TARGET_B, 7) == ClouRFID_OK);
+  RFID->ScanTags(1);
+  CheckParams(&Reader, 7, 2, ClouRFID_TARGET_B);
+  uint32_t Config = Reader.ConfigQty;
+  RFID->ScanTags(1); //not changed - not sent
+  CHECK(Reader.ConfigQty == Config);
+  RFID->ScanTags(2);
+  CheckParams(&Reader, 5, 1, 2);
+  RFID->ScanTags(1);
+  CheckParams(&Reader, 7, 2, ClouRFID_TARGET_B);
+
+  //All antennas back to reader default
+  CHECK(RFID->SetInventory(0, ClouRFID_SESSION_DEFAULT, ClouRFID_TARGET_A, 0) == ClouRFID_OK);
+  RFID->ScanTags(1);
+  CheckParams(&Reader, 5, 1, 2);
+
+  //Restart: reader has our params now, defaults of first start are kept
+  CHECK(RFID->SetInventory(1, 3, ClouRFID_TARGET_A, 2) == ClouRFID_OK);
+  RFID->ScanTags(1);
+  RFID->Stop();
+  CHECK(RFID->Start(Reader.Name, 115200, RS232, 0) == ClouRFID_OK);
+  RFID->ScanTags(2);
+  CheckParams(&Reader, 5, 1, 2);
+  RFID->Stop();
+  delete RFID;
+
+  //Reader doesn't report defaults: default antenna keeps last sent params
+  Reader.BasebandQuery = 0;
+  RFID = new ClouRFID();
+  CHECK(RFID->Start(Reader.Name, 115200, RS232, 0) == ClouRFID_OK);
+  CHECK(RFID->SetInventory(1, 3, ClouRFID_TARGET_A, 2) == ClouRFID_OK);
+  RFID->ScanTags(1);
+  Config = Reader.ConfigQty;
+  RFID->ScanTags(2);
+  CHECK(Reader.ConfigQty == Config);
+  CheckParams(&Reader, 2, 3, ClouRFID_TARGET_A);
+  RFID->Stop();
+  delete RFID;
+
+  //Q by tags of last round: Q = ceil(log2 N), failed reads are not counted
+  std::vector<FakeTag> Scene;
+  for (uint32_t i = 0; i < 9; i++) Scene.push_back(FakeReader::Tag(i, 1, 50));
+  for (uint32_t i = 0; i < 8; i++) {
+    FakeTag T = FakeReader::Tag(100 + i, 1, 50);
+    T.Result = 1;
+    Scene.push_back(T);
+  }
+  Reader.SetScene(Scene);
+  RFID = new ClouRFID();
+  CHECK(RFID->Start(Reader.Name, 115200, RS232, 0) == ClouRFID_OK);
+  CHECK(RFID->SetInventory(1, 2, ClouRFID_TARGET_A, ClouRFID_Q_AUTO) == ClouRFID_OK);
+  RFID->ScanTags(1);
+  CHECK(Reader.ReaderQ == 0); //no round yet
+  RFID->ScanTags(1);
+  CHECK(Reader.ReaderQ == 4);
+  Scene.clear();
+  for (uint32_t i = 0; i < 100; i++) Scene.push_back(FakeReader::Tag(i, 1, 50));
+  Reader.SetScene(Scene);
+  RFID->ScanTags(1);
+  CHECK(Reader.ReaderQ == 4);
+  RFID->ScanTags(1);
+  CHECK(Reader.ReaderQ == 7);
+  RFID->Stop();
+  delete RFID;
+
+  printf("test_inventory: OK\n");
+  return 0;
+}
@@ -0,0 +1,119 @@
+/*! \file test_pause.cpp
+    \brief Flow control: tags uploaded while read is stopped are not lost, no presence aging while inventory is paused.
+    Continuous read fed by FeedByte is stopped by FeedControl at high-water mark and restarted at low-water mark.
+ */
+
+#define ClouRFID_TAG_FIFO_len 10
+#define ClouRFID_FIFO_high 5
+#define ClouRFID_FIFO_low 2
+#define ClouRFID_PRESENCE_len 16
+#define ClouRFID_PRESENCE_miss 2
+#define ClouRFID_FEED_on 1
+#include "fake_reader.h"
+#include "../ClouRFID.cpp"
+
+static ClouRFID RFID;
+
+static void Cycle() {
+  RFID.ScanTags(1);
+  RFID.EndCycle();
+}
+
+//! Get tags from FIFO, return qty of Event
+static uint32_t Drain(uint8_t Event) {
+  uint32_t Qty = 0;
+  ClouRFID_Tag_t Tag;
+  while (RFID.GetTag(&Tag) == ClouRFID_OK) {
+    if (Tag.Event == Event) Qty++;
+  }
+  return Qty;
+}
+
+//! Feed bytes received in Ms (UART RX interrupt of continuous read) and call FeedControl (main loop)
+static void Pump(ClouRFID* Feed, int Fd, double Ms) {
+  double T0 = NowMs();
+  do {
+    uint8_t B[256];
+    ssize_t Rd = read(Fd, B, sizeof(B));
+    for (ssize_t i = 0; i < Rd; i++) Feed->FeedByte(B[i]);
+    if (Rd <= 0) usleep(1000);
+    Feed->FeedControl();
+  } while (NowMs() - T0 < Ms);
+}
+
+int main() {
+  char Name[64];
+  snprintf(Name, sizeof(Name), "/tmp/clourfid_pause_%d", (int)getpid());
+  FakeReader Reader(Name);
+  CHECK(RFID.Start(Reader.Name, 115200, RS232, 0) == ClouRFID_OK);
+
+  std::vector<FakeTag> Scene;
+  for (uint32_t i = 1; i <= 8; i++) Scene.push_back(FakeReader::Tag(i, 1, 50));
+  Reader.SetScene(Scene);
+
+  //Pause at high-water mark, tags uploaded before read stop are in FIFO
+  Cycle();
+  CHECK(RFID.GetTagQty() == 8);
+  CHECK(RFID.GetLostQty() == 0);
+
+  //Paused cycles - tags are not read, but not DEPARTED
+  uint32_t Reads = Reader.ReadQty;
+  for (uint8_t i = 0; i < 2 * ClouRFID_PRESENCE_miss + 1; i++) Cycle();
+  CHECK(Reader.ReadQty == Reads);
+  CHECK(RFID.GetTagQty() == 8);
+
+  //Resume - tags still present, no DEPARTED and no new ARRIVED
+  CHECK(Drain(ClouRFID_ARRIVED) == 8);
+  Cycle();
+  CHECK(Reader.ReadQty == Reads + 1);
+  CHECK(RFID.GetTagQty() == 0);
+  CHECK(RFID.GetLostQty() == 0);
+
+  //Tags leave field - DEPARTED after ClouRFID_PRESENCE_miss cycles
+  Reader.SetScene({});
+  for (uint8_t i = 0; i < ClouRFID_PRESENCE_miss; i++) Cycle();
+  CHECK(Drain(ClouRFID_DEPARTED) == 8);
+
+  RFID.Stop();
+
+  //Continuous read: stopped at high-water mark, tags uploaded before stop are in FIFO
+  Reader.SetScene(Scene);
+  ClouRFID* Feed = new ClouRFID();
+  CHECK(Feed->Start(Reader.Name, 115200, RS232, 0) == ClouRFID_OK);
+  int Fd = open(Reader.Name, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  CHECK(Fd >= 0);
+  CHECK(Feed->FeedStart(1) == ClouRFID_OK);
+  CHECK(Reader.Reading == 1);
+  double T0 = NowMs();
+  while ((Reader.Reading != 0) && (NowMs() - T0 < 3000)) Pump(Feed, Fd, 10);
+  CHECK(Reader.Reading == 0);
+  CHECK(Feed->GetTagQty() >= ClouRFID_FIFO_high);
+  CHECK(Feed->GetLostQty() == 0);
+
+  //Paused: not restarted above low-water mark, pause time counted
+  Reads = Reader.ReadQty;
+  Pump(Feed, Fd, 200);
+  CHECK(Reader.ReadQty == Reads);
+  CHECK(Reader.Reading == 0);
+  CHECK(Feed->GetPauseTime() >= 190);
+
+  //Consumer gets tags - read restarted, pause time stops
+  uint32_t Arrived = 0;
+  ClouRFID_Tag_t Tag;
+  while (Feed->GetTag(&Tag) == ClouRFID_OK) Arrived++;
+  Pump(Feed, Fd, 10);
+  CHECK(Reader.ReadQty == Reads + 1);
+  CHECK(Reader.Reading == 1);
+  uint32_t Pause = Feed->GetPauseTime();
+  Pump(Feed, Fd, 100);
+  CHECK(Feed->GetPauseTime() == Pause);
+  while (Feed->GetTag(&Tag) == ClouRFID_OK) Arrived++;
+  CHECK(Arrived == 8); //tags in field are reported once
+  CHECK(Feed->GetLostQty() == 0);
+  Feed->Stop();
+  close(Fd);
+  delete Feed;
+
+  printf("test_pause: OK\n");
+  return 0;
+}
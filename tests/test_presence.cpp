@@ -0,0 +1,87 @@
+/*! \file test_presence.cpp
+    \brief Presence tracking: ARRIVED / DEPARTED transitions, tag departed and returned before FIFO drain.
+ */
+
+#define ClouRFID_PRESENCE_len 8
+#define ClouRFID_PRESENCE_miss 2
+#include "fake_reader.h"
+#include "../ClouRFID.cpp"
+
+struct Event {
+  uint32_t Id;
+  uint8_t Event;
+};
+
+static ClouRFID RFID;
+
+static void Cycle() {
+  RFID.ScanTags(1);
+  RFID.EndCycle();
+}
+
+static std::vector<Event> Drain() {
+  std::vector<Event> Ret;
+  ClouRFID_Tag_t Tag;
+  while (RFID.GetTag(&Tag) == ClouRFID_OK) {
+    Event E = {FakeReader::TagId(Tag.EPC), Tag.Event};
+    Ret.push_back(E);
+  }
+  return Ret;
+}
+
+int main() {
+  char Name[64];
+  snprintf(Name, sizeof(Name), "/tmp/clourfid_presence_%d", (int)getpid());
+  FakeReader Reader(Name);
+  CHECK(RFID.Start(Reader.Name, 115200, RS232, 0) == ClouRFID_OK);
+
+  //First read - ARRIVED
+  Reader.SetScene({FakeReader::Tag(1, 1, 50), FakeReader::Tag(2, 1, 60)});
+  Cycle();
+  std::vector<Event> E = Drain();
+  CHECK(E.size() == 2);
+  CHECK(E[0].Id == 1 && E[0].Event == ClouRFID_ARRIVED);
+  CHECK(E[1].Id == 2 && E[1].Event == ClouRFID_ARRIVED);
+
+  //Tags still read - no events
+  Cycle();
+  CHECK(Drain().empty());
+
+  //Tag 2 not read ClouRFID_PRESENCE_miss cycles - DEPARTED
+  Reader.SetScene({FakeReader::Tag(1, 1, 50)});
+  Cycle();
+  CHECK(Drain().empty());
+  Cycle();
+  E = Drain();
+  CHECK(E.size() == 1);
+  CHECK(E[0].Id == 2 && E[0].Event == ClouRFID_DEPARTED);
+
+  //Tag 3 arrives, departs and returns while consumer does not get tags
+  Reader.SetScene({FakeReader::Tag(1, 1, 50), FakeReader::Tag(3, 1, 70)});
+  Cycle();
+  Reader.SetScene({FakeReader::Tag(1, 1, 50)});
+  Cycle();
+  Cycle();
+  CHECK(RFID.GetTagQty() == 2);
+  Reader.SetScene({FakeReader::Tag(1, 1, 50), FakeReader::Tag(3, 1, 70)});
+  Cycle();
+  E = Drain();
+  CHECK(E.size() == 3);
+  CHECK(E[0].Id == 3 && E[0].Event == ClouRFID_ARRIVED);
+  CHECK(E[1].Id == 3 && E[1].Event == ClouRFID_DEPARTED);
+  CHECK(E[2].Id == 3 && E[2].Event == ClouRFID_ARRIVED);
+
+  //Returned tag is present - no events, then DEPARTED again
+  Cycle();
+  CHECK(Drain().empty());
+  Reader.SetScene({FakeReader::Tag(1, 1, 50)});
+  Cycle();
+  Cycle();
+  E = Drain();
+  CHECK(E.size() == 1);
+  CHECK(E[0].Id == 3 && E[0].Event == ClouRFID_DEPARTED);
+
+  RFID.Stop();
+  printf("test_presence: OK\n");
+  return 0;
+}
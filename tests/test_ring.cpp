@@ -0,0 +1,93 @@
+/*! \file test_ring.cpp
+    \brief Tag FIFO ring: FeedByte producer thread (reader byte stream with log frames, noise,
+    corrupted frames and re-reads of queued tags) and GetTag consumer thread. Tags must arrive in
+    order, unchanged, without loss. Build with -fsanitize=thread by "make tsan".
+ */
+
+#define ClouRFID_FEED_on 1
+#include "fake_reader.h"
+#include "../ClouRFID.cpp"
+
+static const uint32_t TagQty = 100000;
+static ClouRFID RFID;
+
+static FakeTag Make(uint32_t Id) {
+  return FakeReader::Tag(Id, 1 + Id % 4, (uint8_t)Id);
+}
+
+//! Feed tag upload frame (Bad - corrupted CRC)
+static void Feed(const FakeTag& T, bool Bad) {
+  uint8_t D[64], F[80];
+  uint16_t Len = FakeReader::Frame(0x12, 0x00, D, FakeReader::Upload(T, true, D), F);
+  if (Bad) F[Len - 1] ^= 0x55;
+  for (uint16_t i = 0; i < Len; i++) RFID.FeedByte(F[i]);
+}
+
+//! Feed tag when FIFO has free cell
+static void FeedWait(const FakeTag& T) {
+  while (RFID.GetTagQty() >= ClouRFID_TAG_FIFO_len) sched_yield(); //FIFO full - wait for consumer
+  Feed(T, false);
+}
+
+static void* Producer(void* Arg) {
+  static const char Log[] = "log";
+  uint8_t F[32];
+  uint16_t LogLen = FakeReader::Frame(0x13, 0x00, (const uint8_t*)Log, 3, F);
+  for (uint32_t Id = 1; Id <= TagQty; Id++) {
+    if ((Id % 16) == 0) { //noise between frames
+      for (uint16_t i = 0; i < LogLen; i++) RFID.FeedByte(F[i]);
+      RFID.FeedByte(0x00);
+      Feed(Make(Id | 0x80000000UL), true);
+    }
+    FeedWait(Make(Id));
+    if ((Id % 4) == 0) { //re-read with better signal: queued tag is not changed, consumed one is added again
+      FakeTag T = Make(Id - 1);
+      T.RSSI++;
+      FeedWait(T);
+    }
+  }
+  return NULL;
+}
+
+static void* Consumer(void* Arg) {
+  uint32_t Next = 1;
+  ClouRFID_Tag_t Tag;
+  while (Next <= TagQty) {
+    if (RFID.GetTag(&Tag) != ClouRFID_OK) {
+      sched_yield();
+      continue;
+    }
+    FakeTag T = Make(Next);
+    //re-read of tag Id - 1 (Id % 4 == 0) is queued after tag Id
+    if ((((Next - 1) % 4) == 0) && (FakeReader::TagId(Tag.EPC) == Next - 2) && (Tag.RSSIdBm == (uint8_t)(Next - 1))) continue;
+    CHECK(Tag.EPC_Len == 12);
+    CHECK(memcmp(Tag.EPC, T.EPC, 12) == 0);
+    CHECK(Tag.TID_Len == 12);
+    CHECK(memcmp(Tag.TID, T.EPC, 12) == 0);
+    CHECK(Tag.Ant == T.Ant);
+    CHECK(Tag.RSSIdBm == T.RSSI);
+    Next++;
+  }
+  return NULL;
+}
+
+int main() {
+  pthread_t P, C;
+  pthread_create(&C, NULL, Consumer, NULL);
+  pthread_create(&P, NULL, Producer, NULL);
+  pthread_join(P, NULL);
+  pthread_join(C, NULL);
+  CHECK(RFID.GetTagQty() == 0);
+  CHECK(RFID.GetLostQty() == 0);
+
+  //No consumer: FIFO full, rest of tags lost
+  for (uint32_t Id = 1; Id <= ClouRFID_TAG_FIFO_len + 5; Id++) Feed(Make(TagQty + Id), false);
+  CHECK(RFID.GetTagQty() == ClouRFID_TAG_FIFO_len);
+  CHECK(RFID.GetLostQty() == 5);
+  //Same tag is not added twice
+  Feed(Make(TagQty + 1), false);
+  CHECK(RFID.GetLostQty() == 5);
+
+  printf("test_ring: OK (%u tags)\n", TagQty);
+  return 0;
+}
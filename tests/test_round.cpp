@@ -0,0 +1,42 @@
+/*! \file test_round.cpp
+    \brief Inventory round: tags are published at round end, strongest read of tag in round is kept,
+    re-read of published tag does not change it.
+ */
+
+#include "fake_reader.h"
+#include "../ClouRFID.cpp"
+
+static ClouRFID RFID;
+
+int main() {
+  char Name[64];
+  snprintf(Name, sizeof(Name), "/tmp/clourfid_round_%d", (int)getpid());
+  FakeReader Reader(Name);
+  Reader.AntQty = 2;
+  CHECK(RFID.Start(Reader.Name, 115200, RS232, 0) == ClouRFID_OK);
+
+  //Tag 1 read weak, strong, weak in one round - strongest read is queued
+  Reader.SetScene({FakeReader::Tag(1, 1, 40), FakeReader::Tag(2, 1, 55), FakeReader::Tag(1, 1, 70), FakeReader::Tag(1, 1, 50)});
+  RFID.ScanTags(1);
+  CHECK(RFID.GetTagQty() == 2);
+  ClouRFID_Tag_t Tag;
+  CHECK(RFID.GetTag(&Tag) == ClouRFID_OK);
+  CHECK(FakeReader::TagId(Tag.EPC) == 1 && Tag.RSSIdBm == 70 && Tag.Ant == 1);
+
+  //Tag 2 is published: stronger read on other antenna is dropped
+  Reader.SetScene({FakeReader::Tag(2, 2, 90)});
+  RFID.ScanTags(2);
+  CHECK(RFID.GetTagQty() == 1);
+  CHECK(RFID.GetTag(&Tag) == ClouRFID_OK);
+  CHECK(FakeReader::TagId(Tag.EPC) == 2 && Tag.RSSIdBm == 55 && Tag.Ant == 1);
+
+  //Consumed tag is queued again
+  RFID.ScanTags(2);
+  CHECK(RFID.GetTag(&Tag) == ClouRFID_OK);
+  CHECK(FakeReader::TagId(Tag.EPC) == 2 && Tag.RSSIdBm == 90 && Tag.Ant == 2);
+  CHECK(RFID.GetLostQty() == 0);
+
+  RFID.Stop();
+  printf("test_round: OK\n");
+  return 0;
+}
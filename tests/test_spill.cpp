@@ -0,0 +1,141 @@
+/*! \file test_spill.cpp
+    \brief SD card spill log: replay in read order (FIFO tags before spilled ones), burst of many
+    scans survives with consumer draining FIFO (log written by EndCycle) and with uplink down (SpillTags).
+    Log is written by whole blocks only, replay keeps log file open.
+ */
+
+#define ClouRFID_TAG_FIFO_len 3
+#define ClouRFID_SPILL_batch 4
+#define ClouRFID_SPILL_file "/tmp/clourfid_test_spill.bin"
+#include "fake_reader.h"
+#include <sys/stat.h>
+
+//! Count log file opens
+static uint32_t OpenQty;
+static FILE* CountOpen(const char* Path, const char* Mode) {
+  OpenQty++;
+  return fopen(Path, Mode);
+}
+#define fopen CountOpen
+#include "../ClouRFID.cpp"
+#undef fopen
+
+static ClouRFID RFID;
+static FakeReader* Reader;
+static uint32_t NextId = 1;
+
+//! Check log file size: whole blocks
+static void CheckBlocks() {
+  struct stat St;
+  if (stat(ClouRFID_SPILL_file, &St) != 0) return;
+  CHECK((St.st_size % (ClouRFID_SPILL_batch * ClouRFID_SPILL_rec_len)) == 0);
+}
+
+//! Scan Qty new tags, end cycle
+static void ScanNew(uint32_t Qty) {
+  std::vector<FakeTag> Scene;
+  for (uint32_t i = 0; i < Qty; i++) Scene.push_back(FakeReader::Tag(NextId++, 1, 50));
+  Reader->SetScene(Scene);
+  RFID.ScanTags(1);
+  RFID.EndCycle();
+  CheckBlocks();
+}
+
+//! Get FIFO tags, check order
+static void Drain(uint32_t* Next) {
+  ClouRFID_Tag_t Tag;
+  while (RFID.GetTag(&Tag) == ClouRFID_OK) {
+    CHECK(FakeReader::TagId(Tag.EPC) == *Next);
+    (*Next)++;
+  }
+}
+
+//! Replay log, check order, delete log
+static void Replay(uint32_t* Next) {
+  ClouRFID_Tag_t Tag;
+  while (RFID.ReplayTag(&Tag) == ClouRFID_OK) {
+    CheckBlocks();
+    CHECK(FakeReader::TagId(Tag.EPC) == *Next);
+    (*Next)++;
+  }
+  RFID.SpillClear();
+}
+
+int main() {
+  char Name[64];
+  snprintf(Name, sizeof(Name), "/tmp/clourfid_spill_%d", (int)getpid());
+  Reader = new FakeReader(Name);
+  remove(ClouRFID_SPILL_file);
+  CHECK(RFID.Start(Reader->Name, 115200, RS232, 0) == ClouRFID_OK);
+  uint32_t Next = 1;
+
+  //Reads 1..5 with 3 tags FIFO: FIFO 1 2 3, spilled 4 5
+  ScanNew(5);
+  CHECK(RFID.GetTagQty() == 3);
+  CHECK(RFID.SpillTags() == ClouRFID_OK);
+  CheckBlocks();
+  CHECK(RFID.GetTagQty() == 0);
+  CHECK(RFID.SpillFlush() == ClouRFID_OK);
+  CheckBlocks();
+  Replay(&Next);
+  CHECK(Next == 6);
+  CHECK(RFID.GetLostQty() == 0);
+
+  //After replay new tags go to FIFO again
+  ScanNew(2);
+  CHECK(RFID.GetTagQty() == 2);
+  Drain(&Next);
+  CHECK(Next == 8);
+
+  //Burst of 10 scans, one buffer of new tags each, consumer drains FIFO after each cycle:
+  //after first overflow tags go to log in read order
+  for (uint8_t i = 0; i < 10; i++) {
+    ScanNew(ClouRFID_SPILL_batch);
+    Drain(&Next);
+  }
+  CHECK(RFID.GetLostQty() == 0);
+  Replay(&Next);
+  CHECK(Next == 48);
+
+  //Uplink down: nobody gets FIFO tags, log is written by SpillTags and EndCycle
+  for (uint8_t i = 0; i < 10; i++) {
+    ScanNew(ClouRFID_SPILL_batch);
+    CHECK(RFID.SpillTags() == ClouRFID_OK);
+    CheckBlocks();
+  }
+  CHECK(RFID.GetLostQty() == 0);
+  CHECK(RFID.GetTagQty() == 0);
+  OpenQty = 0;
+  Replay(&Next);
+  CHECK(Next == 88);
+  CHECK(OpenQty <= 3); //replay, write of rest at log end, replay of rest
+
+  //Uplink down, FIFO tags not filling whole block: rest stays in RAM before buffered tags
+  ScanNew(2);
+  CHECK(RFID.SpillTags() == ClouRFID_OK);
+  CheckBlocks();
+  ScanNew(ClouRFID_TAG_FIFO_len + 1);
+  CHECK(RFID.SpillTags() == ClouRFID_OK);
+  CheckBlocks();
+  CHECK(RFID.GetTagQty() == 0);
+  Replay(&Next);
+  CHECK(Next == 88 + 2 + ClouRFID_TAG_FIFO_len + 1);
+
+
+  //Scan without EndCycle overflows both buffers
+  uint32_t Base = Next;
+  std::vector<FakeTag> Scene;
+  for (uint32_t i = 0; i < 3 + 2 * 4 + 2; i++) Scene.push_back(FakeReader::Tag(NextId++, 1, 50));
+  Reader->SetScene(Scene);
+  RFID.ScanTags(1);
+  CHECK(RFID.GetLostQty() == 2);
+  Drain(&Next);
+  Replay(&Next);
+  CHECK(Next == Base + 3 + 2 * 4);
+
+  RFID.Stop();
+  delete Reader;
+  remove(ClouRFID_SPILL_file);
+  printf("test_spill: OK\n");
+  return 0;
+}
@@ -0,0 +1,68 @@
+/*! \file test_tagop.cpp
+    \brief Tag write batch: ClouRFID_OP_depth commands outstanding, pipelined results, late responses after
+    timeout are not matched to next operations.
+ */
+
+#define ClouRFID_OP_timeout 100
+#include "fake_reader.h"
+#include "../ClouRFID.cpp"
+
+static ClouRFID RFID;
+
+int main() {
+  char Name[64];
+  snprintf(Name, sizeof(Name), "/tmp/clourfid_tagop_%d", (int)getpid());
+  FakeReader Reader(Name);
+  CHECK(RFID.Start(Reader.Name, 115200, RS232, 0) == ClouRFID_OK);
+
+  static const uint8_t Data[12] = {0x30, 0x14, 0x25, 0x1D, 0, 0, 0, 0, 0, 0, 0, 1};
+  ClouRFID_TagOp_t Ops[8];
+  memset(Ops, 0, sizeof(Ops));
+  for (uint8_t i = 0; i < 8; i++) {
+    Ops[i].Op = ClouRFID_OP_WRITE_EPC;
+    Ops[i].Ant = 1;
+    Ops[i].Addr = 2;
+    Ops[i].Len = 12;
+    Ops[i].Data = Data;
+  }
+  Ops[5].Len = 3; //odd length - wrong params
+
+  //All answered in time, reader error of operation 2. Operation 0 answered after delay:
+  //reader has got ClouRFID_OP_depth commands meanwhile
+  Reader.AddOp(0, ClouRFID_OP_timeout / 2);
+  Reader.AddOp(0, 0);
+  Reader.AddOp(4, 0);
+  CHECK(RFID.TagOpBatch(Ops, 8) == 6);
+  CHECK(Reader.OpQty == 7);
+  CHECK(Reader.OpSeen == ClouRFID_OP_depth);
+  CHECK(Ops[2].Result == 4);
+  CHECK(Ops[5].Result == ClouRFID_OP_PARAM);
+
+  //Operation 1 answered late, later responses must not be matched to operations 3..
+  Reader.OpQty = 0;
+  Reader.AddOp(0, 0);
+  Reader.AddOp(0, 150);
+  Reader.AddOp(0, 0);
+  Reader.AddOp(4, 0);
+  Reader.AddOp(4, 0);
+  CHECK(RFID.TagOpBatch(Ops, 5) == 1);
+  CHECK(Ops[0].Result == 0);
+  CHECK(Ops[1].Result == ClouRFID_OP_NO_RESP);
+  CHECK(Ops[2].Result == ClouRFID_OP_NO_RESP);
+  CHECK(Ops[3].Result == 4);
+  CHECK(Ops[4].Result == 4);
+
+  //Operation 0 not answered, response of operation 1 after timeout is discarded, batch goes on
+  Reader.OpQty = 0;
+  Reader.AddOp(0, 0, 0);
+  Reader.AddOp(0, 150);
+  CHECK(RFID.TagOpBatch(Ops, 4) == 2);
+  CHECK(Ops[0].Result == ClouRFID_OP_NO_RESP);
+  CHECK(Ops[1].Result == ClouRFID_OP_NO_RESP);
+  CHECK(Ops[2].Result == 0 && Ops[3].Result == 0);
+  CHECK(Reader.OpQty == 4);
+
+  RFID.Stop();
+  printf("test_tagop: OK\n");
+  return 0;
+}